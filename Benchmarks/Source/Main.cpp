@@ -0,0 +1,995 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    processBlock benchmarks across modes, block sizes and channel counts.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+//==============================================================================
+// plain value for one parameter, addressed by its display name.
+struct ParameterValue
+{
+    const char* name;
+    float value;
+};
+
+// one processor configuration to measure.
+struct BenchmarkMode
+{
+    const char* name;
+    ParameterValue parameters[3];   // unused entries have no name
+    WaveshaperTable::Interpolation tableInterpolation;
+    bool doublePrecision = false;   // processBlock (AudioBuffer<double>&)
+    bool silentInput = false;       // digital silence instead of noise (the idle fast path)
+};
+
+const BenchmarkMode benchmarkModes[] =
+{
+    { "bypass",         { { "BYPASS", 1.0f } }, WaveshaperTable::Direct },
+    { "bypass-os4x-fir", { { "BYPASS", 1.0f }, { "Oversampling", 2.0f }, { "Filter", 1.0f } }, WaveshaperTable::Direct },
+    { "clip",           { { "Gain", 1.5f } }, WaveshaperTable::Direct },
+    { "special",        { { "Gain", 1.5f }, { "Special", 1.0f } }, WaveshaperTable::Direct },
+    { "special-table",  { { "Gain", 1.5f }, { "Special", 1.0f } }, WaveshaperTable::Linear },
+    { "clip-adaa1",     { { "Gain", 1.5f }, { "ADAA", 1.0f } }, WaveshaperTable::Direct },
+    { "clip-adaa2",     { { "Gain", 1.5f }, { "ADAA", 2.0f } }, WaveshaperTable::Direct },
+    { "special-adaa1",  { { "Gain", 1.5f }, { "Special", 1.0f }, { "ADAA", 1.0f } }, WaveshaperTable::Direct },
+    { "special-adaa2",  { { "Gain", 1.5f }, { "Special", 1.0f }, { "ADAA", 2.0f } }, WaveshaperTable::Direct },
+    { "clip-os2x-iir",  { { "Gain", 1.5f }, { "Oversampling", 1.0f }, { "Filter", 0.0f } }, WaveshaperTable::Direct },
+    { "clip-os4x-iir",  { { "Gain", 1.5f }, { "Oversampling", 2.0f }, { "Filter", 0.0f } }, WaveshaperTable::Direct },
+    { "clip-os4x-fir",  { { "Gain", 1.5f }, { "Oversampling", 2.0f }, { "Filter", 1.0f } }, WaveshaperTable::Direct },
+    { "clip-os8x-iir",  { { "Gain", 1.5f }, { "Oversampling", 3.0f }, { "Filter", 0.0f } }, WaveshaperTable::Direct },
+    { "clip-f64",       { { "Gain", 1.5f } }, WaveshaperTable::Direct, true },
+    { "special-f64",    { { "Gain", 1.5f }, { "Special", 1.0f } }, WaveshaperTable::Direct, true },
+    { "clip-os4x-f64",  { { "Gain", 1.5f }, { "Oversampling", 2.0f }, { "Filter", 0.0f } }, WaveshaperTable::Direct, true },
+    { "multiband2",     { { "Gain", 1.5f }, { "Bands", 1.0f } }, WaveshaperTable::Direct },
+    { "multiband4",     { { "Gain", 1.5f }, { "Bands", 3.0f }, { "Special2", 1.0f } }, WaveshaperTable::Direct },
+    { "limiter-0.5ms",  { { "Gain", 1.5f }, { "Limiter", 1.0f }, { "Lookahead", 0.5f } }, WaveshaperTable::Direct },
+    { "limiter-5ms",    { { "Gain", 1.5f }, { "Limiter", 1.0f }, { "Lookahead", 5.0f } }, WaveshaperTable::Direct },
+    { "clip-cabinet",   { { "Gain", 1.5f }, { "Cabinet", 1.0f } }, WaveshaperTable::Direct },
+    { "idle",           { { "Gain", 1.5f }, { "Oversampling", 2.0f }, { "Filter", 1.0f } }, WaveshaperTable::Direct, false, true },
+    { "clip-tone",      { { "Gain", 1.5f }, { "PreLowCut", 100.0f }, { "PostHighCut", 6000.0f } }, WaveshaperTable::Direct },
+};
+
+const int blockSizes[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+const int channelCounts[] = { 1, 2, 12, 64 };   // mono, stereo, 7.1.4, 7th-order ambisonics
+
+constexpr double sampleRate = 48000.0;
+
+//==============================================================================
+struct BenchmarkOptions
+{
+    juce::String filter;        // only modes whose name contains this
+    double secondsPerRun = 1.0; // audio processed per measurement
+    int repetitions = 5;        // the median of these is reported
+    juce::File jsonOutput;
+    juce::File baseline;
+    double tolerancePercent = 10.0;
+};
+
+struct BenchmarkResult
+{
+    juce::String mode;
+    int numChannels = 0;
+    int blockSize = 0;
+    double nanosecondsPerSample = 0.0;  // per sample frame, all channels together
+    double realtimeFactor = 0.0;        // audio duration / processing time
+};
+
+juce::String getKey (const juce::String& mode, int numChannels, int blockSize)
+{
+    return mode + "/" + juce::String(numChannels) + "ch/" + juce::String(blockSize);
+}
+
+//==============================================================================
+juce::RangedAudioParameter* findParameter (juce::AudioProcessor& processor, const juce::String& name)
+{
+    for (auto* parameter : processor.getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+            if (ranged->getName(64) == name)
+                return ranged;
+
+    jassertfalse;
+    return nullptr;
+}
+
+void setParameter (juce::AudioProcessor& processor, const juce::String& name, float value)
+{
+    if (auto* parameter = findParameter(processor, name))
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
+
+void applyParameters (juce::AudioProcessor& processor, const BenchmarkMode& mode)
+{
+    for (auto& assignment : mode.parameters)
+        if (assignment.name != nullptr)
+            setParameter(processor, assignment.name, assignment.value);
+}
+
+bool usesCabinet (const BenchmarkMode& mode)
+{
+    return std::any_of(std::begin(mode.parameters), std::end(mode.parameters), [] (const ParameterValue& assignment)
+    {
+        return assignment.name != nullptr && juce::String(assignment.name) == "Cabinet" && assignment.value > 0.0f;
+    });
+}
+
+// two seconds of decaying stereo noise, the longest impulse response the cabinet loads (written once per run).
+juce::File getTestImpulseResponse()
+{
+    static const juce::TemporaryFile file(".wav");
+
+    if (! file.getFile().existsAsFile())
+    {
+        juce::AudioBuffer<float> impulseResponse(2, (int) (ConvolutionStage::maximumLength * sampleRate));
+        juce::Random random(0x1c);
+
+        for (auto channel = 0; channel < impulseResponse.getNumChannels(); ++channel)
+            for (auto i = 0; i < impulseResponse.getNumSamples(); ++i)
+                impulseResponse.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * std::exp((float) (-3.0 * i / sampleRate)));
+
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::FileOutputStream> stream(file.getFile().createOutputStream());
+        std::unique_ptr<juce::AudioFormatWriter> writer(stream != nullptr ? format.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0) : nullptr);
+
+        if (writer != nullptr)
+        {
+            stream.release();
+            writer->writeFromAudioSampleBuffer(impulseResponse, 0, impulseResponse.getNumSamples());
+        }
+    }
+
+    return file.getFile();
+}
+
+// median seconds for numBlocks blocks of processBlock at the given sample type.
+template <typename SampleType>
+double measureProcessBlock (Juce_plugin_distortionAudioProcessor& processor, int numChannels, int blockSize, int numBlocks, bool silentInput, const BenchmarkOptions& options)
+{
+    // one second of noise at roughly -6 dBFS (or silence), read block by block so every call sees fresh input.
+    const auto sourceLength = (int) sampleRate;
+    juce::AudioBuffer<SampleType> source(numChannels, sourceLength);
+    source.clear();
+
+    juce::Random random(0x5eed);
+    if (! silentInput)
+        for (auto channel = 0; channel < numChannels; ++channel)
+            for (auto i = 0; i < sourceLength; ++i)
+                source.setSample(channel, i, (SampleType) (random.nextFloat() - 0.5f));
+
+    juce::AudioBuffer<SampleType> buffer(numChannels, blockSize);
+    juce::MidiBuffer midiMessages;
+    auto sourcePosition = 0;
+
+    auto processOneBlock = [&]
+    {
+        if (sourcePosition + blockSize > sourceLength)
+            sourcePosition = 0;
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+            buffer.copyFrom(channel, 0, source, channel, sourcePosition, blockSize);
+
+        processor.processBlock(buffer, midiMessages);
+        sourcePosition += blockSize;
+    };
+
+    // warm up caches, kernels and smoothers.
+    for (auto i = 0; i < juce::jmax(1, numBlocks / 10); ++i)
+        processOneBlock();
+
+    std::vector<double> timings;
+    for (auto repetition = 0; repetition < options.repetitions; ++repetition)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+        for (auto i = 0; i < numBlocks; ++i)
+            processOneBlock();
+        auto end = juce::Time::getHighResolutionTicks();
+
+        timings.push_back(juce::Time::highResolutionTicksToSeconds(end - start));
+    }
+
+    std::sort(timings.begin(), timings.end());
+    return timings[timings.size() / 2];
+}
+
+BenchmarkResult runBenchmark (const BenchmarkMode& mode, int numChannels, int blockSize, const BenchmarkOptions& options)
+{
+    Juce_plugin_distortionAudioProcessor processor;
+    processor.setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+    processor.setProcessingPrecision(mode.doublePrecision ? juce::AudioProcessor::doublePrecision : juce::AudioProcessor::singlePrecision);
+    processor.setWaveshaperTableOptions(4096, mode.tableInterpolation);
+    applyParameters(processor, mode);
+
+    auto cabinet = usesCabinet(mode);
+    if (cabinet)
+        processor.loadImpulseResponse(getTestImpulseResponse());
+
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    // give the table builder time to publish, so the lookup path is what gets measured.
+    if (mode.tableInterpolation != WaveshaperTable::Direct)
+        juce::Thread::sleep(50);
+
+    // without its engine the cabinet passes the signal through, and the dry path would be timed instead.
+    if (cabinet && ! processor.isImpulseResponseReady())
+        std::cout << "warning: " << mode.name << " runs without its impulse response" << std::endl;
+
+    auto numBlocks = juce::jmax(1, (int) (options.secondsPerRun * sampleRate / blockSize));
+    auto seconds = mode.doublePrecision ? measureProcessBlock<double>(processor, numChannels, blockSize, numBlocks, mode.silentInput, options)
+                                        : measureProcessBlock<float>(processor, numChannels, blockSize, numBlocks, mode.silentInput, options);
+    auto numSamples = (double) numBlocks * blockSize;
+
+    processor.releaseResources();
+
+    BenchmarkResult result;
+    result.mode = mode.name;
+    result.numChannels = numChannels;
+    result.blockSize = blockSize;
+    result.nanosecondsPerSample = seconds * 1.0e9 / numSamples;
+    result.realtimeFactor = (numSamples / sampleRate) / seconds;
+    return result;
+}
+
+//==============================================================================
+juce::var toJSON (const juce::Array<BenchmarkResult>& results)
+{
+    juce::Array<juce::var> entries;
+    for (auto& result : results)
+    {
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("mode", result.mode);
+        entry->setProperty("channels", result.numChannels);
+        entry->setProperty("blockSize", result.blockSize);
+        entry->setProperty("nsPerSample", result.nanosecondsPerSample);
+        entry->setProperty("realtimeFactor", result.realtimeFactor);
+        entries.add(juce::var(entry));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("sampleRate", sampleRate);
+    root->setProperty("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+    root->setProperty("results", entries);
+    return juce::var(root);
+}
+
+// returns the number of results slower than the baseline by more than the tolerance.
+int compareWithBaseline (const juce::Array<BenchmarkResult>& results, const BenchmarkOptions& options)
+{
+    auto baseline = juce::JSON::parse(options.baseline);
+    auto* entries = baseline["results"].getArray();
+    if (entries == nullptr)
+    {
+        std::cout << "error: no results in " << options.baseline.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::map<juce::String, double> baselineTimes;
+    for (auto& entry : *entries)
+        baselineTimes[getKey(entry["mode"].toString(), (int) entry["channels"], (int) entry["blockSize"])] = (double) entry["nsPerSample"];
+
+    auto numRegressions = 0;
+    for (auto& result : results)
+    {
+        auto found = baselineTimes.find(getKey(result.mode, result.numChannels, result.blockSize));
+        if (found == baselineTimes.end() || found->second <= 0.0)
+            continue;
+
+        auto changePercent = (result.nanosecondsPerSample / found->second - 1.0) * 100.0;
+        if (changePercent > options.tolerancePercent)
+        {
+            std::cout << "regression " << getKey(result.mode, result.numChannels, result.blockSize)
+                      << ": " << juce::String(found->second, 3) << " -> " << juce::String(result.nanosecondsPerSample, 3)
+                      << " ns/sample (+" << juce::String(changePercent, 1) << "%)" << std::endl;
+            ++numRegressions;
+        }
+    }
+
+    return numRegressions;
+}
+
+//==============================================================================
+using ViolationCounts = std::array<int, RealtimeSafetyChecker::TotalViolationNum>;
+
+ViolationCounts getViolations()
+{
+    ViolationCounts counts;
+    for (auto violation = 0; violation < RealtimeSafetyChecker::TotalViolationNum; ++violation)
+        counts[(size_t) violation] = RealtimeSafetyChecker::getNumViolations((RealtimeSafetyChecker::Violation) violation);
+    return counts;
+}
+
+// changes a parameter inside a realtime section, the way plugin wrappers pass host automation on the audio thread.
+// JUCE itself locks the parameter's listener lists for any change; that share is measured on "In", whose listener
+// only flags the editor, and added to excused rather than held against the processor.
+void automateParameter (juce::AudioProcessor& processor, const char* name, float value, ViolationCounts& excused)
+{
+    auto change = [] (juce::RangedAudioParameter& parameter, float normalisedValue)
+    {
+        const RealtimeSafetyChecker::ScopedRealtimeSection realtimeSection;
+        parameter.setValue(normalisedValue);
+        parameter.sendValueChangedMessageToListeners(normalisedValue);
+    };
+
+    auto* reference = findParameter(processor, "In");
+    auto* parameter = findParameter(processor, name);
+
+    auto start = getViolations();
+    change(*reference, reference->getValue() > 0.5f ? 0.25f : 0.75f);
+    auto afterReference = getViolations();
+    change(*parameter, parameter->convertTo0to1(value));
+    auto end = getViolations();
+
+    for (size_t violation = 0; violation < excused.size(); ++violation)
+    {
+        auto referenceCount = afterReference[violation] - start[violation];
+        excused[violation] += referenceCount + juce::jmin(referenceCount, end[violation] - afterReference[violation]);
+    }
+}
+
+// a block of fresh noise at the buffer's precision; hosts may also pass shorter blocks than prepared.
+template <typename SampleType>
+void processNoiseBlock (juce::AudioProcessor& processor, juce::AudioBuffer<SampleType>& buffer, int numSamples, juce::MidiBuffer& midiMessages, juce::Random& random)
+{
+    for (auto channel = 0; channel < buffer.getNumChannels(); ++channel)
+        for (auto i = 0; i < numSamples; ++i)
+            buffer.setSample(channel, i, (SampleType) (random.nextFloat() * 2.0f - 1.0f));
+
+    juce::AudioBuffer<SampleType> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples);
+    processor.processBlock(block, midiMessages);
+}
+
+// drives every parameter combination through processBlock and counts heap use and locks inside it.
+int runRealtimeCheck()
+{
+    if (! RealtimeSafetyChecker::isEnabled())
+    {
+        std::cout << "error: built without DISTORTION_REALTIME_CHECKS" << std::endl;
+        return 1;
+    }
+
+    RealtimeSafetyChecker::setAbortOnViolation(false);
+    RealtimeSafetyChecker::resetViolations();
+
+    const WaveshaperTable::Interpolation interpolations[] = { WaveshaperTable::Direct, WaveshaperTable::Linear, WaveshaperTable::Cubic };
+    const int checkBlockSizes[] = { 16, 512, 4096 };
+
+    juce::Random random(0x5eed);
+    juce::MidiBuffer midiMessages;
+    ViolationCounts excused {};
+    auto numBlocks = 0;
+
+    // both precisions run every phase; their processBlock overloads share the code, but not its instantiation.
+    for (auto doublePrecision : { false, true })
+    for (auto interpolation : interpolations)
+    {
+        for (auto numChannels : channelCounts)
+        {
+            for (auto blockSize : checkBlockSizes)
+            {
+                Juce_plugin_distortionAudioProcessor processor;
+                processor.setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+                processor.setProcessingPrecision(doublePrecision ? juce::AudioProcessor::doublePrecision : juce::AudioProcessor::singlePrecision);
+                processor.setWaveshaperTableOptions(1024, interpolation);
+                processor.loadImpulseResponse(getTestImpulseResponse());
+                processor.prepareToPlay(sampleRate, blockSize);
+
+                // an open editor turns the level meters on.
+                processor.getLevelMeter().setEnabled(true);
+
+                juce::AudioBuffer<float> buffer(doublePrecision ? 0 : numChannels, blockSize);
+                juce::AudioBuffer<double> doubleBuffer(doublePrecision ? numChannels : 0, blockSize);
+
+                auto processNoise = [&] (int numSamples)
+                {
+                    if (doublePrecision)
+                        processNoiseBlock(processor, doubleBuffer, numSamples, midiMessages, random);
+                    else
+                        processNoiseBlock(processor, buffer, numSamples, midiMessages, random);
+
+                    ++numBlocks;
+                };
+
+                // switch the choices between blocks, as host automation would, without preparing again.
+                for (auto bypass = 0; bypass < 2; ++bypass)
+                for (auto special = 0; special < 2; ++special)
+                for (auto antiAliasing = 0; antiAliasing < AntiderivativeShaper::TotalOrderNum; ++antiAliasing)
+                for (auto oversampling = 0; oversampling < OversamplingStage::TotalFactorNum; ++oversampling)
+                for (auto filter = 0; filter < OversamplingStage::TotalFilterTypeNum; ++filter)
+                {
+                    setParameter(processor, "BYPASS", (float) bypass);
+                    setParameter(processor, "Special", (float) special);
+                    setParameter(processor, "ADAA", (float) antiAliasing);
+                    setParameter(processor, "Oversampling", (float) oversampling);
+                    setParameter(processor, "Filter", (float) filter);
+
+                    for (auto step = 0; step < 4; ++step)
+                    {
+                        // move the continuous parameters, so that every block runs the ramps.
+                        setParameter(processor, "In", 0.5f + 0.25f * (float) step);
+                        setParameter(processor, "Gain", 1.0f + 0.3f * (float) step);
+                        setParameter(processor, "Out", 1.25f - 0.2f * (float) step);
+
+                        processNoise(step % 2 == 0 ? blockSize : blockSize / 2 + 1);
+                    }
+                }
+
+                // hosts may also automate the choices that change the latency from the audio thread itself.
+                setParameter(processor, "BYPASS", 0.0f);
+                for (auto oversampling = 0; oversampling < OversamplingStage::TotalFactorNum; ++oversampling)
+                for (auto filter = 0; filter < OversamplingStage::TotalFilterTypeNum; ++filter)
+                {
+                    automateParameter(processor, "Oversampling", (float) oversampling, excused);
+                    automateParameter(processor, "Filter", (float) filter, excused);
+                    processNoise(blockSize);
+                }
+
+                for (auto antiAliasing = 0; antiAliasing < AntiderivativeShaper::TotalOrderNum; ++antiAliasing)
+                {
+                    automateParameter(processor, "ADAA", (float) antiAliasing, excused);
+                    processNoise(blockSize);
+                }
+
+                // split into bands, moving the crossovers and each band's drive and shape between blocks.
+                for (auto bands = 1; bands < MultibandStage::maxBands; ++bands)
+                for (auto oversampling = 0; oversampling < OversamplingStage::TotalFactorNum; oversampling += 2)
+                {
+                    setParameter(processor, "Bands", (float) bands);
+                    setParameter(processor, "Oversampling", (float) oversampling);
+
+                    for (auto step = 0; step < 4; ++step)
+                    {
+                        for (auto band = 1; band <= MultibandStage::maxBands; ++band)
+                        {
+                            setParameter(processor, "Gain" + juce::String(band), 1.0f + 0.25f * (float) ((step + band) % 4));
+                            setParameter(processor, "Special" + juce::String(band), (float) ((step + band) % 2));
+                        }
+
+                        for (auto crossover = 1; crossover < MultibandStage::maxBands; ++crossover)
+                            setParameter(processor, "Crossover" + juce::String(crossover), 150.0f * (float) (crossover * (step + 1)));
+
+                        processNoise(step % 2 == 0 ? blockSize : blockSize / 2 + 1);
+                    }
+                }
+
+                setParameter(processor, "Bands", 0.0f);
+
+                // switch the limiter in and out and move its lookahead, which changes the latency as well.
+                const float lookaheads[] = { (float) LookaheadLimiter::minimumLookahead, 1.5f, (float) LookaheadLimiter::maximumLookahead };
+                for (auto lookahead : lookaheads)
+                {
+                    automateParameter(processor, "Lookahead", lookahead, excused);
+
+                    for (auto step = 0; step < 4; ++step)
+                    {
+                        setParameter(processor, "Limiter", (float) (step < 3));
+                        processNoise(step % 2 == 0 ? blockSize : blockSize / 2 + 1);
+                    }
+                }
+
+                // switch the cabinet in and out (every switch resets it), then replace its impulse response while playing,
+                // which hands the audio thread a new engine and the worker the old one to free.
+                for (auto step = 0; step < 8; ++step)
+                {
+                    setParameter(processor, "Cabinet", (float) (step % 4 != 3));
+                    processNoise(step % 2 == 0 ? blockSize : blockSize / 2 + 1);
+                }
+
+                processor.loadImpulseResponse(getTestImpulseResponse());
+                for (auto step = 0; step < 40; ++step)
+                {
+                    processNoise(blockSize);
+                    juce::Thread::sleep(5);
+                }
+
+                setParameter(processor, "Cabinet", 0.0f);
+
+                // move the tone filters, switching each section off and back on along the way.
+                for (auto step = 0; step < 8; ++step)
+                {
+                    for (auto stage : { "Pre", "Post" })
+                    {
+                        auto offset = juce::String(stage) == "Pre" ? 0 : 2;
+                        setParameter(processor, juce::String(stage) + "Tilt", (float) ((step + offset) % 4 - 2) * ToneFilterStage::maximumTilt / 2.0f);
+                        setParameter(processor, juce::String(stage) + "LowCut", (step + offset) % 4 == 0 ? ToneFilterStage::lowCutOff : 60.0f * (float) (step + 1));
+                        setParameter(processor, juce::String(stage) + "HighCut", (step + offset) % 4 == 1 ? ToneFilterStage::highCutOff : 2000.0f * (float) (step + 1));
+                    }
+
+                    processNoise(step % 2 == 0 ? blockSize : blockSize / 2 + 1);
+                }
+
+                // MIDI CC inside the blocks (at times more than the 256 events a block keeps) and program changes;
+                // the buffer is filled outside processBlock, as a host would.
+                for (auto step = 0; step < 8; ++step)
+                {
+                    auto numSamples = step % 2 == 0 ? blockSize : blockSize / 2 + 1;
+                    auto numControllers = step % 4 == 3 ? 600 : 4;
+
+                    midiMessages.clear();
+                    for (auto event = 0; event < numControllers; ++event)
+                        midiMessages.addEvent(juce::MidiMessage::controllerEvent(1, 21 + event % 4, random.nextInt(128)), random.nextInt(numSamples));
+
+                    if (step % 4 == 1)
+                        midiMessages.addEvent(juce::MidiMessage::programChange(1, step % processor.getNumPrograms()), random.nextInt(numSamples));
+
+                    processNoise(numSamples);
+                }
+
+                midiMessages.clear();
+                processor.releaseResources();
+            }
+        }
+    }
+
+    auto violations = getViolations();
+    auto numAllocations   = violations[RealtimeSafetyChecker::Allocation] - excused[RealtimeSafetyChecker::Allocation];
+    auto numDeallocations = violations[RealtimeSafetyChecker::Deallocation] - excused[RealtimeSafetyChecker::Deallocation];
+    auto numMutexLocks    = violations[RealtimeSafetyChecker::MutexLock] - excused[RealtimeSafetyChecker::MutexLock];
+    auto numWaits         = violations[RealtimeSafetyChecker::ConditionWait] - excused[RealtimeSafetyChecker::ConditionWait];
+
+    std::cout << numBlocks << " blocks: " << numAllocations << " allocations, " << numDeallocations << " deallocations, "
+              << numMutexLocks << " locks, " << numWaits << " condition waits inside processBlock and automation" << std::endl;
+
+    // only what is hooked can be counted; say so, so a clean run is not read as more than it is.
+    std::cout << "hooked: " << RealtimeSafetyChecker::getHookedFunctions() << std::endl;
+
+    return numAllocations + numDeallocations + numMutexLocks + numWaits == 0 ? 0 : 1;
+}
+
+//==============================================================================
+// median microseconds per call, over a few repetitions of numCalls calls.
+template <typename Function>
+double measureMicroseconds (int numCalls, Function&& function)
+{
+    std::vector<double> timings;
+    for (auto repetition = 0; repetition < 5; ++repetition)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+        for (auto i = 0; i < numCalls; ++i)
+            function();
+        auto end = juce::Time::getHighResolutionTicks();
+
+        timings.push_back(juce::Time::highResolutionTicksToSeconds(end - start) * 1.0e6 / numCalls);
+    }
+
+    std::sort(timings.begin(), timings.end());
+    return timings[timings.size() / 2];
+}
+
+// compares saving and loading the binary state with the XML state it replaced.
+int runStateBenchmark()
+{
+    constexpr int numCalls = 10000;
+
+    Juce_plugin_distortionAudioProcessor processor;
+    setParameter(processor, "Gain", 1.5f);
+    setParameter(processor, "Special", 1.0f);
+    setParameter(processor, "Oversampling", 2.0f);
+
+    juce::MemoryBlock binaryState, xmlState;
+    processor.getStateInformation(binaryState);
+    processor.getXmlStateInformation(xmlState);
+
+    // both formats must restore the same values.
+    juce::MemoryBlock restored;
+    processor.setStateInformation(xmlState.getData(), (int) xmlState.getSize());
+    processor.getStateInformation(restored);
+    if (restored != binaryState)
+    {
+        std::cout << "error: the XML and binary states restore different values" << std::endl;
+        return 1;
+    }
+
+    // the destination block is reused, as a session manager snapshotting instances would.
+    juce::MemoryBlock destination;
+    auto binarySave = measureMicroseconds(numCalls, [&] { processor.getStateInformation(destination); });
+    auto xmlSave    = measureMicroseconds(numCalls, [&] { processor.getXmlStateInformation(destination); });
+    auto binaryLoad = measureMicroseconds(numCalls, [&] { processor.setStateInformation(binaryState.getData(), (int) binaryState.getSize()); });
+    auto xmlLoad    = measureMicroseconds(numCalls, [&] { processor.setStateInformation(xmlState.getData(), (int) xmlState.getSize()); });
+
+    std::cout << juce::String("format").paddedRight(' ', 8) << juce::String("bytes").paddedLeft(' ', 7)
+              << juce::String("save us").paddedLeft(' ', 10) << juce::String("load us").paddedLeft(' ', 10) << std::endl;
+    std::cout << juce::String("binary").paddedRight(' ', 8) << juce::String((int) binaryState.getSize()).paddedLeft(' ', 7)
+              << juce::String(binarySave, 3).paddedLeft(' ', 10) << juce::String(binaryLoad, 3).paddedLeft(' ', 10) << std::endl;
+    std::cout << juce::String("xml").paddedRight(' ', 8) << juce::String((int) xmlState.getSize()).paddedLeft(' ', 7)
+              << juce::String(xmlSave, 3).paddedLeft(' ', 10) << juce::String(xmlLoad, 3).paddedLeft(' ', 10) << std::endl;
+
+    return 0;
+}
+
+//==============================================================================
+// the curve the core must reproduce: one sample at a time, in double, with the gains written out.
+template <DistortionCore::Mode mode>
+double referenceShape (double input, double preGain, double outputGain)
+{
+    auto x = input * preGain;
+    auto shaped = mode == DistortionCore::Mode::Tanh ? std::tanh(x) : juce::jlimit(-1.0, 1.0, x);
+    return shaped * outputGain;
+}
+
+// odd length, so that nothing depends on a vector width.
+constexpr int coreCheckSamples = 999;
+
+// runs DistortionCore::process through every combination of ramped and steady gains; returns the largest error.
+template <DistortionCore::Mode mode, typename SampleType>
+double checkCore (const DistortionCore::GainStaging& staging, juce::Random& random)
+{
+    std::vector<SampleType> input((size_t) coreCheckSamples), output;
+    std::vector<float> preGainRamp((size_t) coreCheckSamples), outputRamp((size_t) coreCheckSamples);
+
+    // the pre-gain ramps from silence to twice its steady value, the output gain down to silence.
+    auto preGain = DistortionCore::getPreGain<mode>(staging);
+    for (auto i = 0; i < coreCheckSamples; ++i)
+    {
+        auto position = (float) i / (float) (coreCheckSamples - 1);
+        input[(size_t) i] = (SampleType) (random.nextDouble() * 4.0 - 2.0);
+        preGainRamp[(size_t) i] = preGain * 2.0f * position;
+        outputRamp[(size_t) i] = staging.outputGain * (1.0f - position);
+    }
+
+    auto maximumError = 0.0;
+    for (auto rampedPreGain : { false, true })
+    {
+        for (auto rampedOutput : { false, true })
+        {
+            auto* pre = rampedPreGain ? preGainRamp.data() : nullptr;
+            auto* out = rampedOutput ? outputRamp.data() : nullptr;
+
+            output = input;
+            DistortionCore::process<mode>(output.data(), coreCheckSamples, pre, preGain, out, staging.outputGain);
+
+            for (auto i = 0; i < coreCheckSamples; ++i)
+            {
+                auto expected = referenceShape<mode>((double) input[(size_t) i], pre != nullptr ? pre[i] : preGain, out != nullptr ? out[i] : staging.outputGain);
+                maximumError = juce::jmax(maximumError, std::abs(expected - (double) output[(size_t) i]));
+            }
+        }
+    }
+
+    return maximumError;
+}
+
+// runs a ramp through DistortionCore::State in two calls, so the ramp position carries over between them; with kernels,
+// through the float overload the processor uses, which hands the steady spans to the CPU-specific kernels.
+template <DistortionCore::Mode mode, typename SampleType>
+double checkState (const DistortionCore::GainStaging& staging, const DistortionCore::GainStaging& target, int rampLength,
+                   const DistortionKernels::KernelSet* kernels, juce::Random& random)
+{
+    std::vector<SampleType> input((size_t) coreCheckSamples);
+    for (auto& sample : input)
+        sample = (SampleType) (random.nextDouble() * 4.0 - 2.0);
+
+    auto state = DistortionCore::makeState<mode>(staging);
+    DistortionCore::setTarget<mode>(state, target, rampLength);
+
+    auto output = input;
+    auto maximumError = 0.0;
+    const int starts[] = { 0, coreCheckSamples / 3, coreCheckSamples };
+
+    for (auto part = 0; part < 2; ++part)
+    {
+        auto start = starts[part];
+        auto numSamples = starts[part + 1] - start;
+
+        if (kernels != nullptr)
+            DistortionCore::process<mode>(output.data() + start, numSamples, state, *kernels);
+        else
+            DistortionCore::process<mode>(output.data() + start, numSamples, state);
+
+        // the expected gains are read from the state before it moves on.
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            auto expected = referenceShape<mode>((double) input[(size_t) (start + i)], DistortionCore::getPreGain(state, i), DistortionCore::getOutputGain(state, i));
+            maximumError = juce::jmax(maximumError, std::abs(expected - (double) output[(size_t) (start + i)]));
+        }
+
+        DistortionCore::advance(state, numSamples);
+    }
+
+    return maximumError;
+}
+
+// steady, a ramp of the output gain only, and a ramp of every gain that ends within the checked span.
+template <DistortionCore::Mode mode, typename SampleType>
+double checkStates (const DistortionCore::GainStaging& staging, const DistortionKernels::KernelSet* kernels, juce::Random& random)
+{
+    auto louder = DistortionCore::makeGainStaging(1.0f, 1.0f, 1.5f);
+    auto outputOnly = staging;
+    outputOnly.outputGain = louder.outputGain;
+
+    auto maximumError = checkState<mode, SampleType>(staging, staging, 0, kernels, random);
+    maximumError = juce::jmax(maximumError, checkState<mode, SampleType>(staging, outputOnly, 2 * coreCheckSamples / 3, kernels, random));
+    return juce::jmax(maximumError, checkState<mode, SampleType>(staging, louder, 2 * coreCheckSamples / 3, kernels, random));
+}
+
+// checks the DSP core and the kernels against the scalar reference over the whole slider range.
+int runCoreCheck()
+{
+    using DistortionCore::Mode;
+
+    // the tanh approximation is within about 1e-6, scaled by output gains of up to 4.5;
+    // state ramps compute their gains in float, so they are held to the float tolerance in double too.
+    constexpr double floatTolerance = 1.0e-5;
+    constexpr double doubleTolerance = 1.0e-12;
+
+    auto& kernels = DistortionKernels::getBestKernels();
+    double errors[10] = {};
+    juce::Random random(1);
+
+    for (auto gain : { 1.0f, 1.25f, 1.5f, 1.75f, 2.0f })
+    {
+        for (auto volume : { 0.25f, 1.0f, 1.5f })
+        {
+            auto staging = DistortionCore::makeGainStaging(volume, gain, volume);
+
+            errors[0] = juce::jmax(errors[0], checkCore<Mode::HardClip, float>(staging, random));
+            errors[1] = juce::jmax(errors[1], checkCore<Mode::Tanh, float>(staging, random));
+            errors[2] = juce::jmax(errors[2], checkCore<Mode::HardClip, double>(staging, random));
+            errors[3] = juce::jmax(errors[3], checkCore<Mode::Tanh, double>(staging, random));
+            errors[4] = juce::jmax(errors[4], checkStates<Mode::HardClip, float>(staging, nullptr, random));
+            errors[5] = juce::jmax(errors[5], checkStates<Mode::Tanh, float>(staging, nullptr, random));
+            errors[6] = juce::jmax(errors[6], checkStates<Mode::HardClip, double>(staging, nullptr, random));
+            errors[7] = juce::jmax(errors[7], checkStates<Mode::Tanh, double>(staging, nullptr, random));
+            errors[8] = juce::jmax(errors[8], checkStates<Mode::HardClip, float>(staging, &kernels, random));
+            errors[9] = juce::jmax(errors[9], checkStates<Mode::Tanh, float>(staging, &kernels, random));
+        }
+    }
+
+    const juce::String names[] = { "core clip float", "core tanh float", "core clip double", "core tanh double",
+                                    "state clip float", "state tanh float", "state clip double", "state tanh double",
+                                    juce::String("kernels clip ") + kernels.name, juce::String("kernels tanh ") + kernels.name };
+    const double tolerances[] = { floatTolerance, floatTolerance, doubleTolerance, doubleTolerance,
+                                  floatTolerance, floatTolerance, floatTolerance, floatTolerance, floatTolerance, floatTolerance };
+
+    auto failures = 0;
+    for (auto i = 0; i < 10; ++i)
+    {
+        auto passed = errors[i] <= tolerances[i];
+        failures += passed ? 0 : 1;
+
+        std::cout << names[i].paddedRight(' ', 24) << juce::String(errors[i], 3, true).paddedLeft(' ', 12)
+                  << (passed ? "  ok" : "  FAILED") << std::endl;
+    }
+
+    return failures > 0 ? 1 : 0;
+}
+
+//==============================================================================
+// the test impulse response as the cabinet plays it: at the file's own rate, unit energy in the loudest channel.
+juce::AudioBuffer<float> readTestImpulseResponse()
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    juce::AudioBuffer<float> impulseResponse;
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(getTestImpulseResponse()));
+    if (reader == nullptr)
+        return impulseResponse;
+
+    impulseResponse.setSize((int) reader->numChannels, (int) reader->lengthInSamples);
+    reader->read(&impulseResponse, 0, impulseResponse.getNumSamples(), 0, true, true);
+
+    auto energy = 0.0;
+    for (auto channel = 0; channel < impulseResponse.getNumChannels(); ++channel)
+    {
+        auto channelEnergy = 0.0;
+        for (auto i = 0; i < impulseResponse.getNumSamples(); ++i)
+            channelEnergy += (double) impulseResponse.getSample(channel, i) * impulseResponse.getSample(channel, i);
+
+        energy = juce::jmax(energy, channelEnergy);
+    }
+
+    if (energy > 0.0)
+        impulseResponse.applyGain((float) (1.0 / std::sqrt(energy)));
+
+    return impulseResponse;
+}
+
+// plays noise through the cabinet in realtime mode, paced like a host, and compares it with a direct convolution;
+// a tail frame the worker did not finish in time plays as silence and shows up as a large error.
+int runConvolutionCheck()
+{
+    // the error of the float FFTs, relative to the loudest output sample.
+    constexpr double tolerance = 1.0e-5;
+    const int numChannels = 2;
+    const int length = (int) sampleRate;
+
+    auto impulseResponse = readTestImpulseResponse();
+    if (impulseResponse.getNumSamples() == 0)
+    {
+        std::cout << "error: cannot read the test impulse response" << std::endl;
+        return 1;
+    }
+
+    juce::AudioBuffer<float> input(numChannels, length);
+    juce::Random random(0xc0);
+    for (auto channel = 0; channel < numChannels; ++channel)
+        for (auto i = 0; i < length; ++i)
+            input.setSample(channel, i, random.nextFloat() - 0.5f);
+
+    std::vector<double> expected((size_t) (numChannels * length));
+    auto peak = 0.0;
+    for (auto channel = 0; channel < numChannels; ++channel)
+    {
+        auto* taps = impulseResponse.getReadPointer(juce::jmin(channel, impulseResponse.getNumChannels() - 1));
+        auto* samples = input.getReadPointer(channel);
+
+        for (auto i = 0; i < length; ++i)
+        {
+            auto sum = 0.0;
+            for (auto tap = 0; tap < juce::jmin(i + 1, impulseResponse.getNumSamples()); ++tap)
+                sum += (double) taps[tap] * samples[i - tap];
+
+            expected[(size_t) (channel * length + i)] = sum;
+            peak = juce::jmax(peak, std::abs(sum));
+        }
+    }
+
+    auto failures = 0;
+    for (auto blockSize : { 16, 512, 4096 })
+    {
+        ConvolutionStage convolution;
+        convolution.loadImpulseResponse(getTestImpulseResponse());
+        convolution.prepare(sampleRate, numChannels, blockSize, true);
+
+        juce::AudioBuffer<float> output;
+        output.makeCopyOf(input);
+
+        // each block is due when the previous one has played, so the worker gets the time a host would give it.
+        auto startTime = juce::Time::getMillisecondCounterHiRes();
+        for (auto position = 0; position < length; position += blockSize)
+        {
+            auto numSamples = juce::jmin(blockSize, length - position);
+            convolution.process(output, position, numSamples, numChannels);
+
+            auto dueTime = startTime + 1000.0 * (position + numSamples) / sampleRate;
+            auto waitTime = (int) (dueTime - juce::Time::getMillisecondCounterHiRes());
+            if (waitTime > 0)
+                juce::Thread::sleep(waitTime);
+        }
+
+        auto maximumError = 0.0;
+        for (auto channel = 0; channel < numChannels; ++channel)
+            for (auto i = 0; i < length; ++i)
+                maximumError = juce::jmax(maximumError, std::abs(expected[(size_t) (channel * length + i)] - (double) output.getSample(channel, i)));
+
+        auto relativeError = maximumError / juce::jmax(peak, 1.0e-9);
+        auto passed = relativeError <= tolerance;
+        failures += passed ? 0 : 1;
+
+        std::cout << ("block " + juce::String(blockSize)).paddedRight(' ', 12) << juce::String(relativeError, 3, true).paddedLeft(' ', 12)
+                  << "  late frames " << convolution.getNumLateTailFrames() << (passed ? "  ok" : "  FAILED") << std::endl;
+
+        convolution.release();
+    }
+
+    return failures > 0 ? 1 : 0;
+}
+
+//==============================================================================
+void printUsage()
+{
+    std::cout << "usage: benchmarks [options]\n"
+                 "\n"
+                 "  --filter <text>          only run modes whose name contains <text>\n"
+                 "  --seconds <seconds>      audio processed per measurement (default: 1)\n"
+                 "  --repetitions <count>    measurements per case, the median is reported (default: 5)\n"
+                 "  --json <file>            write the results as JSON\n"
+                 "  --baseline <file>        compare against a previous --json output\n"
+                 "  --tolerance <percent>    allowed slowdown against the baseline (default: 10)\n"
+                 "  --realtime-check         run every parameter combination and fail on heap use, locks or waits in processBlock\n"
+                 "  --state-benchmark        compare saving and loading the binary state with the XML state\n"
+                 "  --core-check             compare the DSP core and the CPU-specific kernels with a scalar reference\n"
+                 "  --convolution-check      compare the realtime cabinet convolution with a direct convolution" << std::endl;
+}
+
+juce::Result parseArguments (const juce::StringArray& arguments, BenchmarkOptions& options)
+{
+    for (auto i = 0; i < arguments.size(); ++i)
+    {
+        auto argument = arguments[i];
+        auto hasValue = i + 1 < arguments.size();
+
+        if (argument == "--filter" && hasValue)
+            options.filter = arguments[++i];
+        else if (argument == "--seconds" && hasValue)
+            options.secondsPerRun = juce::jmax(0.01, arguments[++i].getDoubleValue());
+        else if (argument == "--repetitions" && hasValue)
+            options.repetitions = juce::jmax(1, arguments[++i].getIntValue());
+        else if (argument == "--json" && hasValue)
+            options.jsonOutput = juce::File::getCurrentWorkingDirectory().getChildFile(arguments[++i]);
+        else if (argument == "--baseline" && hasValue)
+            options.baseline = juce::File::getCurrentWorkingDirectory().getChildFile(arguments[++i]);
+        else if (argument == "--tolerance" && hasValue)
+            options.tolerancePercent = arguments[++i].getDoubleValue();
+        else
+            return juce::Result::fail("unknown or incomplete option: " + argument);
+    }
+
+    if (options.baseline != juce::File() && ! options.baseline.existsAsFile())
+        return juce::Result::fail("baseline not found: " + options.baseline.getFullPathName());
+
+    return juce::Result::ok();
+}
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the parameter tree expects a message manager, even without a message loop.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray arguments;
+    for (auto i = 1; i < argc; ++i)
+        arguments.add(juce::CharPointer_UTF8(argv[i]));
+
+    if (arguments.contains("-h") || arguments.contains("--help"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    if (arguments.contains("--realtime-check"))
+        return runRealtimeCheck();
+
+    if (arguments.contains("--state-benchmark"))
+        return runStateBenchmark();
+
+    if (arguments.contains("--core-check"))
+        return runCoreCheck();
+
+    if (arguments.contains("--convolution-check"))
+        return runConvolutionCheck();
+
+    BenchmarkOptions options;
+    auto parseResult = parseArguments(arguments, options);
+    if (parseResult.failed())
+    {
+        std::cout << "error: " << parseResult.getErrorMessage() << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    std::cout << "kernels: " << DistortionKernels::getBestKernels().name << ", cpu: " << juce::SystemStats::getCpuModel() << std::endl;
+    std::cout << juce::String("mode").paddedRight(' ', 16) << juce::String("ch").paddedLeft(' ', 3) << juce::String("block").paddedLeft(' ', 7)
+              << juce::String("ns/sample").paddedLeft(' ', 12) << juce::String("x realtime").paddedLeft(' ', 12) << std::endl;
+
+    juce::Array<BenchmarkResult> results;
+    for (auto& mode : benchmarkModes)
+    {
+        if (options.filter.isNotEmpty() && ! juce::String(mode.name).contains(options.filter))
+            continue;
+
+        for (auto numChannels : channelCounts)
+        {
+            for (auto blockSize : blockSizes)
+            {
+                auto result = runBenchmark(mode, numChannels, blockSize, options);
+                results.add(result);
+
+                std::cout << result.mode.paddedRight(' ', 16) << juce::String(numChannels).paddedLeft(' ', 3) << juce::String(blockSize).paddedLeft(' ', 7)
+                          << juce::String(result.nanosecondsPerSample, 3).paddedLeft(' ', 12) << juce::String(result.realtimeFactor, 1).paddedLeft(' ', 12) << std::endl;
+            }
+        }
+    }
+
+    if (options.jsonOutput != juce::File())
+    {
+        if (! options.jsonOutput.replaceWithText(juce::JSON::toString(toJSON(results))))
+        {
+            std::cout << "error: cannot write " << options.jsonOutput.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.baseline != juce::File())
+        return compareWithBaseline(results, options) == 0 ? 0 : 1;
+
+    return 0;
+}
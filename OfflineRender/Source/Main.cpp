@@ -0,0 +1,316 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Headless offline renderer: streams audio files through the processor.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+//==============================================================================
+// settings shared by every file of one run.
+struct RenderOptions
+{
+    juce::File outputDirectory;
+    juce::String outputFormat;          // file extension without the dot, empty keeps the input format
+    juce::MemoryBlock state;            // blob saved by getStateInformation
+    juce::StringPairArray parameters;   // parameter name or id -> plain value
+    int blockSize = 8192;
+    int numThreads = juce::SystemStats::getNumCpus();
+};
+
+juce::CriticalSection consoleLock;
+
+void printLine (const juce::String& text)
+{
+    const juce::ScopedLock lock(consoleLock);
+    std::cout << text << std::endl;
+}
+
+//==============================================================================
+juce::RangedAudioParameter* findParameter (juce::AudioProcessor& processor, const juce::String& nameOrID)
+{
+    for (auto* parameter : processor.getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+            if (ranged->getParameterID() == nameOrID || ranged->getName(64).equalsIgnoreCase(nameOrID))
+                return ranged;
+
+    return nullptr;
+}
+
+juce::Result applyParameters (juce::AudioProcessor& processor, const juce::StringPairArray& parameters)
+{
+    for (auto& key : parameters.getAllKeys())
+    {
+        auto* parameter = findParameter(processor, key);
+        if (parameter == nullptr)
+            return juce::Result::fail("unknown parameter: " + key);
+
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(parameters[key].getFloatValue()));
+    }
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Result renderFile (const juce::File& input, const RenderOptions& options)
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(input));
+    if (reader == nullptr)
+        return juce::Result::fail("unsupported or unreadable file");
+
+    auto numChannels = (int) reader->numChannels;
+    if (numChannels < 1 || numChannels > Juce_plugin_distortionAudioProcessor::maxNumChannels)
+        return juce::Result::fail("only files with 1 to " + juce::String(Juce_plugin_distortionAudioProcessor::maxNumChannels) + " channels are supported");
+
+    // choose the output format and file.
+    auto extension = options.outputFormat.isNotEmpty() ? options.outputFormat : input.getFileExtension().substring(1);
+    auto* format = formats.findFormatForFileExtension(extension);
+    if (format == nullptr)
+        return juce::Result::fail("no writer for ." + extension);
+
+    auto output = options.outputDirectory.getChildFile(input.getFileNameWithoutExtension() + "." + extension);
+    if (output == input)
+        return juce::Result::fail("output would overwrite the input");
+
+    // keep the source bit depth when the output format can store it.
+    auto bitDepths = format->getPossibleBitDepths();
+    auto bitsPerSample = bitDepths.contains((int) reader->bitsPerSample) ? (int) reader->bitsPerSample : bitDepths.getLast();
+
+    output.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream(output.createOutputStream());
+    if (stream == nullptr)
+        return juce::Result::fail("cannot create " + output.getFullPathName());
+
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), reader->sampleRate, (unsigned int) numChannels,
+                                                                            bitsPerSample, reader->metadataValues, 0));
+    if (writer == nullptr)
+        return juce::Result::fail("cannot write " + extension + " with " + juce::String(numChannels) + " channels at " + juce::String(bitsPerSample) + " bits");
+
+    // the writer owns the stream from here on.
+    stream.release();
+
+    // set up the processor exactly as a host would, without an editor.
+    Juce_plugin_distortionAudioProcessor processor;
+    processor.setNonRealtime(true);
+    processor.setPlayConfigDetails(numChannels, numChannels, reader->sampleRate, options.blockSize);
+
+    if (options.state.getSize() > 0)
+        processor.setStateInformation(options.state.getData(), (int) options.state.getSize());
+
+    auto parameterResult = applyParameters(processor, options.parameters);
+    if (parameterResult.failed())
+        return parameterResult;
+
+    processor.prepareToPlay(reader->sampleRate, options.blockSize);
+
+    // stream block by block; the reader pads with silence past the end, which flushes the latency.
+    juce::AudioBuffer<float> buffer(numChannels, options.blockSize);
+    juce::MidiBuffer midiMessages;
+
+    auto latency = (juce::int64) processor.getLatencySamples();
+    auto totalLength = reader->lengthInSamples;
+    auto samplesToSkip = latency;
+    auto samplesToWrite = totalLength;
+
+    for (juce::int64 readPosition = 0; samplesToWrite > 0;)
+    {
+        auto numSamples = (int) juce::jmin((juce::int64) options.blockSize, totalLength + latency - readPosition);
+
+        buffer.setSize(numChannels, numSamples, false, false, true);
+        reader->read(&buffer, 0, numSamples, readPosition, true, true);
+        processor.processBlock(buffer, midiMessages);
+        readPosition += numSamples;
+
+        // drop the latency from the head, so the output lines up with the input.
+        auto skip = (int) juce::jmin(samplesToSkip, (juce::int64) numSamples);
+        auto count = (int) juce::jmin(samplesToWrite, (juce::int64) (numSamples - skip));
+        samplesToSkip -= skip;
+
+        if (count > 0 && ! writer->writeFromAudioSampleBuffer(buffer, skip, count))
+            return juce::Result::fail("write error on " + output.getFullPathName());
+
+        samplesToWrite -= count;
+    }
+
+    processor.releaseResources();
+    return juce::Result::ok();
+}
+
+//==============================================================================
+class RenderJob  : public juce::ThreadPoolJob
+{
+public:
+    RenderJob (const juce::File& input, const RenderOptions& options)
+        : juce::ThreadPoolJob (input.getFileName()), _input (input), _options (options)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        auto startTime = juce::Time::getMillisecondCounterHiRes();
+        _result = renderFile(_input, _options);
+        auto elapsed = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+        if (_result.wasOk())
+            printLine("done   " + _input.getFullPathName() + " (" + juce::String(elapsed, 2) + " s)");
+        else
+            printLine("failed " + _input.getFullPathName() + ": " + _result.getErrorMessage());
+
+        return jobHasFinished;
+    }
+
+    bool succeeded() const noexcept { return _result.wasOk(); }
+
+private:
+    juce::File _input;
+    const RenderOptions& _options;
+    juce::Result _result { juce::Result::ok() };
+};
+
+//==============================================================================
+void printUsage()
+{
+    printLine("usage: offline_render -o <output directory> [options] <input files...>\n"
+              "\n"
+              "  -o, --output-dir <dir>   directory for the rendered files\n"
+              "  --format <wav|flac|aiff> output format (default: same as the input)\n"
+              "  --state <file>           state blob saved by getStateInformation\n"
+              "  --param <name>=<value>   plain parameter value, e.g. Gain=1.5 or Special=1 (repeatable)\n"
+              "  --block-size <samples>   processing block size (default: 8192)\n"
+              "  --threads <count>        files rendered in parallel (default: number of cores)");
+}
+
+juce::Result parseArguments (const juce::StringArray& arguments, RenderOptions& options, juce::Array<juce::File>& inputs)
+{
+    for (auto i = 0; i < arguments.size(); ++i)
+    {
+        auto argument = arguments[i];
+        auto hasValue = i + 1 < arguments.size();
+
+        if ((argument == "-o" || argument == "--output-dir") && hasValue)
+        {
+            options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(arguments[++i]);
+        }
+        else if (argument == "--format" && hasValue)
+        {
+            options.outputFormat = arguments[++i].trimCharactersAtStart(".").toLowerCase();
+        }
+        else if (argument == "--state" && hasValue)
+        {
+            auto stateFile = juce::File::getCurrentWorkingDirectory().getChildFile(arguments[++i]);
+            if (! stateFile.loadFileAsData(options.state))
+                return juce::Result::fail("cannot read state file " + stateFile.getFullPathName());
+        }
+        else if (argument == "--param" && hasValue)
+        {
+            auto assignment = arguments[++i];
+            if (! assignment.containsChar('='))
+                return juce::Result::fail("expected <name>=<value>: " + assignment);
+
+            options.parameters.set(assignment.upToFirstOccurrenceOf("=", false, false).trim(),
+                                   assignment.fromFirstOccurrenceOf("=", false, false).trim());
+        }
+        else if (argument == "--block-size" && hasValue)
+        {
+            options.blockSize = arguments[++i].getIntValue();
+            if (options.blockSize < 16)
+                return juce::Result::fail("block size must be at least 16");
+        }
+        else if (argument == "--threads" && hasValue)
+        {
+            options.numThreads = arguments[++i].getIntValue();
+            if (options.numThreads < 1)
+                return juce::Result::fail("thread count must be at least 1");
+        }
+        else if (argument.startsWith("-"))
+        {
+            return juce::Result::fail("unknown or incomplete option: " + argument);
+        }
+        else
+        {
+            inputs.add(juce::File::getCurrentWorkingDirectory().getChildFile(argument));
+        }
+    }
+
+    if (options.outputDirectory == juce::File())
+        return juce::Result::fail("no output directory");
+
+    if (inputs.isEmpty())
+        return juce::Result::fail("no input files");
+
+    return juce::Result::ok();
+}
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the parameter tree expects a message manager, even without a message loop.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray arguments;
+    for (auto i = 1; i < argc; ++i)
+        arguments.add(juce::CharPointer_UTF8(argv[i]));
+
+    if (arguments.isEmpty() || arguments.contains("-h") || arguments.contains("--help"))
+    {
+        printUsage();
+        return arguments.isEmpty() ? 1 : 0;
+    }
+
+    RenderOptions options;
+    juce::Array<juce::File> inputs;
+
+    auto parseResult = parseArguments(arguments, options, inputs);
+    if (parseResult.failed())
+    {
+        printLine("error: " + parseResult.getErrorMessage());
+        printUsage();
+        return 1;
+    }
+
+    // reject unknown parameter names once, rather than once per file.
+    {
+        Juce_plugin_distortionAudioProcessor processor;
+        auto parameterResult = applyParameters(processor, options.parameters);
+        if (parameterResult.failed())
+        {
+            printLine("error: " + parameterResult.getErrorMessage());
+            return 1;
+        }
+    }
+
+    auto createResult = options.outputDirectory.createDirectory();
+    if (createResult.failed())
+    {
+        printLine("error: " + createResult.getErrorMessage());
+        return 1;
+    }
+
+    // a fixed number of workers; each one holds a single file's buffers at a time.
+    juce::ThreadPool pool(juce::jmin(options.numThreads, inputs.size()));
+    juce::OwnedArray<RenderJob> jobs;
+
+    for (auto& input : inputs)
+        pool.addJob(jobs.add(new RenderJob(input, options)), false);
+
+    auto numFailed = 0;
+    for (auto* job : jobs)
+    {
+        pool.waitForJobToFinish(job, -1);
+        if (! job->succeeded())
+            ++numFailed;
+    }
+
+    printLine(juce::String(jobs.size() - numFailed) + " of " + juce::String(jobs.size()) + " files rendered");
+    return numFailed == 0 ? 0 : 1;
+}
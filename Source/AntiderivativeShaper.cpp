@@ -0,0 +1,251 @@
+/*
+  ==============================================================================
+
+    AntiderivativeShaper.cpp
+    Antiderivative anti-aliasing (ADAA) for the clipping nonlinearities.
+
+  ==============================================================================
+*/
+
+#include "AntiderivativeShaper.h"
+
+namespace
+{
+// below this input difference the divided differences lose too many digits,
+// so they are replaced by the midpoint evaluation they converge to.
+constexpr double illConditionedTolerance = 1.0e-5;
+
+// Li2(w) on [0, 1/2] as a polynomial in t = 4w - 1, highest power first.
+// a degree 19 Chebyshev interpolant, within 1.1e-16 of Li2 over the whole interval (the rounding of the evaluation);
+// its error is smooth, so the divided differences of F2 do not amplify it the way they would a table's.
+constexpr double dilogarithmCoefficients[] =
+{
+    2.90544893340055639e-12, 9.67007503867160995e-12, 1.78435475362828098e-11, 6.07139495954440136e-11,
+    2.39163703693294609e-10, 8.24079317021470041e-10, 2.83271897958786648e-09, 9.98846881083427308e-09,
+    3.57494690352593730e-08, 1.30030926657758701e-07, 4.82750111431810340e-07, 1.83840163233453697e-06,
+    7.23054756659163602e-06, 2.96683089313467529e-05, 1.29007082945435588e-04, 6.10346084574616842e-04,
+    3.30143155800115143e-03, 2.28256304407765363e-02, 2.87682072451780901e-01, 2.67652639082732624e-01,
+};
+
+// Li2(-u) for 0 <= u <= 1.
+// Li2(z) = -Li2(z / (z - 1)) - log(1 - z)^2 / 2 maps the argument into [0, 1/2], where the polynomial holds.
+double negativeDilogarithm (double u) noexcept
+{
+    auto t = 4.0 * u / (1.0 + u) - 1.0;
+    auto sum = 0.0;
+    for (auto coefficient : dilogarithmCoefficients)
+        sum = sum * t + coefficient;
+
+    auto logarithm = std::log1p(u);
+    return -sum - 0.5 * logarithm * logarithm;
+}
+
+//==============================================================================
+// f(x) = clamp(x, -1, 1)
+struct HardClipFunctions
+{
+    static double f0 (double x) noexcept
+    {
+        return juce::jlimit(-1.0, 1.0, x);
+    }
+
+    static double f1 (double x) noexcept
+    {
+        auto a = std::abs(x);
+        return a <= 1.0 ? 0.5 * x * x : a - 0.5;
+    }
+
+    static double f2 (double x) noexcept
+    {
+        if (std::abs(x) <= 1.0)
+            return x * x * x / 6.0;
+
+        auto s = x > 0.0 ? 1.0 : -1.0;
+        return s * (0.5 * x * x + 1.0 / 6.0) - 0.5 * x;
+    }
+};
+
+// f(x) = tanh(x)
+struct TanhFunctions
+{
+    static double f0 (double x) noexcept
+    {
+        return std::tanh(x);
+    }
+
+    // log(cosh(x)), written so that it does not overflow for large |x|.
+    static double f1 (double x) noexcept
+    {
+        auto a = std::abs(x);
+        return a + std::log1p(std::exp(-2.0 * a)) - juce::MathConstants<double>::ln2;
+    }
+
+    // integral of log(cosh(x)); odd, since log(cosh(x)) is even.
+    static double f2 (double x) noexcept
+    {
+        auto a = std::abs(x);
+        auto value = 0.5 * a * a
+                   - a * juce::MathConstants<double>::ln2
+                   + 0.5 * negativeDilogarithm(std::exp(-2.0 * a))
+                   + juce::MathConstants<double>::pi * juce::MathConstants<double>::pi / 24.0;
+        return x < 0.0 ? -value : value;
+    }
+};
+
+// (F2(a) - F2(b)) / (a - b), or F1 at the midpoint when a and b are too close.
+template <typename Functions>
+double dividedDifference (double a, double b, double f2a, double f2b) noexcept
+{
+    auto delta = a - b;
+    if (std::abs(delta) < illConditionedTolerance)
+        return Functions::f1(0.5 * (a + b));
+
+    return (f2a - f2b) / delta;
+}
+}
+
+//==============================================================================
+void AntiderivativeShaper::prepare (int numChannels)
+{
+    _states.assign((size_t) juce::jmax(0, numChannels), ChannelState());
+}
+
+void AntiderivativeShaper::reset() noexcept
+{
+    std::fill(_states.begin(), _states.end(), ChannelState());
+}
+
+void AntiderivativeShaper::process (int channel, float* data, int numSamples, Shape shape, int order) noexcept
+{
+    processSamples(channel, data, numSamples, shape, order);
+}
+
+void AntiderivativeShaper::process (int channel, double* data, int numSamples, Shape shape, int order) noexcept
+{
+    processSamples(channel, data, numSamples, shape, order);
+}
+
+template <typename SampleType>
+void AntiderivativeShaper::processSamples (int channel, SampleType* data, int numSamples, Shape shape, int order) noexcept
+{
+    if (order == Off)
+        return;
+
+    // the caller prepares one state per input channel, so this only guards against misuse.
+    if (! juce::isPositiveAndBelow(channel, (int) _states.size()))
+    {
+        jassertfalse;
+        return;
+    }
+
+    auto& state = _states[(size_t) channel];
+
+    // the cached antiderivatives belong to the previous function, so rebuild them from the stored inputs.
+    if (state.shape != shape || state.order != order)
+    {
+        if (shape == Tanh)
+            refresh<TanhFunctions>(state);
+        else
+            refresh<HardClipFunctions>(state);
+
+        state.shape = shape;
+        state.order = order;
+    }
+
+    if (shape == Tanh)
+    {
+        if (order == FirstOrder)
+            processFirstOrder<TanhFunctions>(state, data, numSamples);
+        else
+            processSecondOrder<TanhFunctions>(state, data, numSamples);
+    }
+    else
+    {
+        if (order == FirstOrder)
+            processFirstOrder<HardClipFunctions>(state, data, numSamples);
+        else
+            processSecondOrder<HardClipFunctions>(state, data, numSamples);
+    }
+}
+
+template <typename Functions>
+void AntiderivativeShaper::refresh (ChannelState& state) noexcept
+{
+    state.antiderivative1 = Functions::f1(state.x1);
+    state.antiderivative2 = Functions::f2(state.x1);
+    state.difference = dividedDifference<Functions>(state.x1, state.x2, state.antiderivative2, Functions::f2(state.x2));
+}
+
+template <typename Functions, typename SampleType>
+void AntiderivativeShaper::processFirstOrder (ChannelState& state, SampleType* data, int numSamples) noexcept
+{
+    auto x1 = state.x1;
+    auto x2 = state.x2;
+    auto f1x1 = state.antiderivative1;
+
+    for (auto i = 0; i < numSamples; ++i)
+    {
+        auto x = (double) data[i];
+        auto f1x = Functions::f1(x);
+        auto delta = x - x1;
+
+        // y[n] = (F1(x[n]) - F1(x[n-1])) / (x[n] - x[n-1])
+        if (std::abs(delta) < illConditionedTolerance)
+            data[i] = (SampleType) Functions::f0(0.5 * (x + x1));
+        else
+            data[i] = (SampleType) ((f1x - f1x1) / delta);
+
+        x2 = x1;
+        x1 = x;
+        f1x1 = f1x;
+    }
+
+    // x[n-2] is kept as well, so that switching to second order can rebuild its state.
+    state.x1 = x1;
+    state.x2 = x2;
+    state.antiderivative1 = f1x1;
+}
+
+template <typename Functions, typename SampleType>
+void AntiderivativeShaper::processSecondOrder (ChannelState& state, SampleType* data, int numSamples) noexcept
+{
+    auto x1 = state.x1;
+    auto x2 = state.x2;
+    auto f2x1 = state.antiderivative2;
+    auto previousDifference = state.difference;
+
+    for (auto i = 0; i < numSamples; ++i)
+    {
+        auto x = (double) data[i];
+        auto f2x = Functions::f2(x);
+        auto difference = dividedDifference<Functions>(x, x1, f2x, f2x1);
+        auto delta = x - x2;
+
+        // y[n] = 2 / (x[n] - x[n-2]) * (D[n] - D[n-1])
+        if (std::abs(delta) >= illConditionedTolerance)
+        {
+            data[i] = (SampleType) (2.0 * (difference - previousDifference) / delta);
+        }
+        else
+        {
+            // x[n] ~= x[n-2]: expand around their midpoint instead.
+            auto midpoint = 0.5 * (x + x2);
+            auto midpointDelta = midpoint - x1;
+
+            if (std::abs(midpointDelta) < illConditionedTolerance)
+                data[i] = (SampleType) Functions::f0(0.5 * (midpoint + x1));
+            else
+                data[i] = (SampleType) (2.0 / midpointDelta * (Functions::f1(midpoint) + (f2x1 - Functions::f2(midpoint)) / midpointDelta));
+        }
+
+        x2 = x1;
+        x1 = x;
+        f2x1 = f2x;
+        previousDifference = difference;
+    }
+
+    state.x1 = x1;
+    state.x2 = x2;
+    state.antiderivative2 = f2x1;
+    state.difference = previousDifference;
+}
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    AntiderivativeShaper.h
+    Antiderivative anti-aliasing (ADAA) for the clipping nonlinearities.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class AntiderivativeShaper
+{
+public:
+    // ADAA̎
+    enum Order
+    {
+        Off = 0,      //  (ʏ̃J[lŏ)
+        FirstOrder,   // 1 (0.5Tvx)
+        SecondOrder,  // 2 (1Tvx)
+        TotalOrderNum,
+    };
+
+    // `֐̎
+    enum Shape
+    {
+        HardClip = 0, // clamp(x, -1, 1)
+        Tanh,         // tanh(x)
+    };
+
+    // ĐȌ (`lƂ̏Ԃm)
+    void prepare(int numChannels);
+
+    // Ԃ̃NA
+    void reset() noexcept;
+
+    // ɂx (郌[gł̃TvA10.5A21)
+    static double getDelaySamples(int order) noexcept { return 0.5 * juce::jlimit(0, TotalOrderNum - 1, order); }
+
+    // data ɔ`֐Kp (͂臒l 1 ɂȂ悤Kς)
+    void process(int channel, float* data, int numSamples, Shape shape, int order) noexcept;
+    void process(int channel, double* data, int numSamples, Shape shape, int order) noexcept;
+
+private:
+    // `lƂ̉ߋTvƌn֐l
+    struct ChannelState
+    {
+        double x1 = 0.0;              // x[n-1]
+        double x2 = 0.0;              // x[n-2]
+        double antiderivative1 = 0.0; // F1(x[n-1])
+        double antiderivative2 = 0.0; // F2(x[n-1])
+        double difference = 0.0;      // (F2(x[n-1]) - F2(x[n-2])) / (x[n-1] - x[n-2])
+        int shape = -1;               // n֐lvZ֐
+        int order = Off;              // n֐lvZ
+    };
+
+    template <typename SampleType>
+    void processSamples(int channel, SampleType* data, int numSamples, Shape shape, int order) noexcept;
+
+    template <typename Functions>
+    static void refresh(ChannelState& state) noexcept;
+
+    template <typename Functions, typename SampleType>
+    static void processFirstOrder(ChannelState& state, SampleType* data, int numSamples) noexcept;
+
+    template <typename Functions, typename SampleType>
+    static void processSecondOrder(ChannelState& state, SampleType* data, int numSamples) noexcept;
+
+    std::vector<ChannelState> _states;
+};
@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    BypassStage.cpp
+    Click-free, latency-compensated bypass around the whole effect.
+
+  ==============================================================================
+*/
+
+#include "BypassStage.h"
+
+void BypassStage::setCrossfadeLength (double milliseconds) noexcept
+{
+    _crossfadeLengthMilliseconds = juce::jmax(0.0, milliseconds);
+}
+
+void BypassStage::prepare (double sampleRate, int numChannels, int maximumBlockSize, int maximumDelay, bool doublePrecision)
+{
+    _fadeLength = juce::jmax(1, juce::roundToInt(_crossfadeLengthMilliseconds * sampleRate / 1000.0));
+    _maximumDelay = juce::jmax(0, maximumDelay);
+    _delay = juce::jmin(_delay, _maximumDelay);
+    _capacity = _maximumDelay + juce::jmax(1, maximumBlockSize);
+
+    // only the precision the host uses is kept, as in the oversampling stage.
+    numChannels = juce::jmax(1, numChannels);
+    _delayLine.setSize(doublePrecision ? 0 : numChannels, doublePrecision ? 0 : _capacity);
+    _doubleDelayLine.setSize(doublePrecision ? numChannels : 0, doublePrecision ? _capacity : 0);
+
+    _wetGains.allocate((size_t) _capacity, true);
+    _dryGains.allocate((size_t) _capacity, true);
+
+    reset(_bypassed);
+}
+
+void BypassStage::reset (bool bypassed) noexcept
+{
+    _bypassed = bypassed;
+    _fadePosition = bypassed ? _fadeLength : 0;
+    _writePosition = 0;
+    _delayLine.clear();
+    _doubleDelayLine.clear();
+}
+
+void BypassStage::setBypassed (bool shouldBeBypassed) noexcept
+{
+    // the fade runs from wherever it is now, so toggling mid-fade simply reverses it.
+    _bypassed = shouldBeBypassed;
+}
+
+void BypassStage::setDelay (int numSamples) noexcept
+{
+    numSamples = juce::jlimit(0, _maximumDelay, numSamples);
+    if (numSamples == _delay)
+        return;
+
+    // the stored history belongs to the old delay (or was not kept at all), so play silence instead.
+    _delay = numSamples;
+    _delayLine.clear();
+    _doubleDelayLine.clear();
+}
+
+bool BypassStage::needsDry() const noexcept
+{
+    return _capacity > 0 && (_delay > 0 || isFading());
+}
+
+template <typename SampleType>
+void BypassStage::processBypassed (juce::AudioBuffer<SampleType>& buffer, int numChannels) noexcept
+{
+    // nothing to compensate: the input already is the output.
+    if (_delay == 0 || _capacity == 0)
+        return;
+
+    auto numSamples = buffer.getNumSamples();
+    auto chunkSize = _capacity - _maximumDelay;
+    for (auto startSample = 0; startSample < numSamples; startSample += chunkSize)
+    {
+        auto chunkLength = juce::jmin(chunkSize, numSamples - startSample);
+        pushDry(buffer, startSample, chunkLength, numChannels);
+        mixDry(buffer, startSample, chunkLength, numChannels);
+    }
+}
+
+template <typename SampleType>
+void BypassStage::pushDry (const juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numChannels) noexcept
+{
+    if (! needsDry())
+        return;
+
+    auto& delayLine = getDelayLine(SampleType());
+    numChannels = juce::jmin(numChannels, delayLine.getNumChannels());
+
+    auto size1 = juce::jmin(numSamples, _capacity - _writePosition);
+    for (auto channel = 0; channel < numChannels; ++channel)
+    {
+        delayLine.copyFrom(channel, _writePosition, buffer, channel, startSample, size1);
+        delayLine.copyFrom(channel, 0, buffer, channel, startSample + size1, numSamples - size1);
+    }
+}
+
+template <typename SampleType>
+void BypassStage::mixDry (juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numChannels) noexcept
+{
+    if (! needsDry())
+        return;
+
+    auto& delayLine = getDelayLine(SampleType());
+    numChannels = juce::jmin(numChannels, delayLine.getNumChannels());
+
+    auto targetPosition = _bypassed ? _fadeLength : 0;
+    auto fading = _fadePosition != targetPosition;
+    auto fullyBypassed = ! fading && _bypassed;
+    auto readPosition = (_writePosition - _delay + _capacity) % _capacity;
+
+    if (fading)
+    {
+        // equal-power gains, so the level does not dip halfway through the fade.
+        auto step = _bypassed ? 1 : -1;
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            auto phase = juce::MathConstants<float>::halfPi * (float) _fadePosition / (float) _fadeLength;
+            _wetGains[i] = std::cos(phase);
+            _dryGains[i] = std::sin(phase);
+
+            if (_fadePosition != targetPosition)
+                _fadePosition += step;
+        }
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+        {
+            auto* channelData = buffer.getWritePointer(channel, startSample);
+            auto* dry = delayLine.getReadPointer(channel);
+
+            for (auto i = 0, dryIndex = readPosition; i < numSamples; ++i, ++dryIndex)
+            {
+                if (dryIndex == _capacity)
+                    dryIndex = 0;
+
+                channelData[i] = channelData[i] * (SampleType) _wetGains[i] + dry[dryIndex] * (SampleType) _dryGains[i];
+            }
+        }
+    }
+    else if (fullyBypassed)
+    {
+        // the effect did not run, so the output is the delayed input alone.
+        auto size1 = juce::jmin(numSamples, _capacity - readPosition);
+        for (auto channel = 0; channel < numChannels; ++channel)
+        {
+            buffer.copyFrom(channel, startSample, delayLine, channel, readPosition, size1);
+            buffer.copyFrom(channel, startSample + size1, delayLine, channel, 0, numSamples - size1);
+        }
+    }
+
+    // fully active with a delay: the input was only kept, so that a later fade has its history.
+    _writePosition = (_writePosition + numSamples) % _capacity;
+}
+
+template void BypassStage::processBypassed<float> (juce::AudioBuffer<float>&, int) noexcept;
+template void BypassStage::processBypassed<double> (juce::AudioBuffer<double>&, int) noexcept;
+template void BypassStage::pushDry<float> (const juce::AudioBuffer<float>&, int, int, int) noexcept;
+template void BypassStage::pushDry<double> (const juce::AudioBuffer<double>&, int, int, int) noexcept;
+template void BypassStage::mixDry<float> (juce::AudioBuffer<float>&, int, int, int) noexcept;
+template void BypassStage::mixDry<double> (juce::AudioBuffer<double>&, int, int, int) noexcept;
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    BypassStage.h
+    Click-free, latency-compensated bypass around the whole effect.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class BypassStage
+{
+public:
+    // ؂ւ̃NXtF[h(ms) ( prepare L)
+    void setCrossfadeLength(double milliseconds) noexcept;
+
+    // ĐȌ (maximumDelay ̓hCMx点őTvAgp鐸x̑m)
+    void prepare(double sampleRate, int numChannels, int maximumBlockSize, int maximumDelay, bool doublePrecision);
+
+    // Ԃ̃NA (NXtF[hŎw肵Ԃɂ)
+    void reset(bool bypassed) noexcept;
+
+    // oCpX̖ڕW (ubN̐擪ŎwAωꍇ̓NXtF[hJn)
+    void setBypassed(bool shouldBeBypassed) noexcept;
+
+    // hCM̒x(Tv) (GtFNg̃CeV[ɍ킹)
+    void setDelay(int numSamples) noexcept;
+
+    // SɃoCpXĂ邩 (NXtF[h false)
+    bool isFullyBypassed() const noexcept { return _bypassed && _fadePosition == _fadeLength; }
+
+    // NXtF[h (pushDry  mixDry Ă΂ȂƃNXtF[hi܂Ȃ)
+    bool isFading() const noexcept { return _fadePosition != (_bypassed ? _fadeLength : 0); }
+
+    // SɃoCpXĂԂ̏ (xhCMóAxΉȂ)
+    template <typename SampleType>
+    void processBypassed(juce::AudioBuffer<SampleType>& buffer, int numChannels) noexcept;
+
+    // GtFNgO̓͂̕ۑ (numSamples  maximumBlockSize ȉ)
+    template <typename SampleType>
+    void pushDry(const juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numChannels) noexcept;
+
+    // GtFNg̏o͂ƃhCM̃NXtF[h (pushDry ƓԂŌĂ)
+    template <typename SampleType>
+    void mixDry(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numChannels) noexcept;
+
+private:
+    // hCM̕ۑKv (xꍇƃNXtF[h)
+    bool needsDry() const noexcept;
+
+    // xƂ̒xobt@ (̓Tv^̑Ip)
+    juce::AudioBuffer<float>& getDelayLine(float) noexcept { return _delayLine; }
+    juce::AudioBuffer<double>& getDelayLine(double) noexcept { return _doubleDelayLine; }
+
+    // hCM̒xobt@ (gpȂx̑͋)
+    juce::AudioBuffer<float> _delayLine;
+    juce::AudioBuffer<double> _doubleDelayLine;
+    int _capacity = 0;          // xobt@̒ (őx + őubNTCY)
+    int _maximumDelay = 0;
+    int _delay = 0;
+    int _writePosition = 0;
+
+    // NXtF[h (0 = GtFNgA_fadeLength = oCpX)
+    juce::HeapBlock<float> _wetGains;
+    juce::HeapBlock<float> _dryGains;
+    double _crossfadeLengthMilliseconds = 10.0;
+    int _fadeLength = 1;
+    int _fadePosition = 0;
+    bool _bypassed = false;
+};
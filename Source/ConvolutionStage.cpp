@@ -0,0 +1,787 @@
+/*
+  ==============================================================================
+
+    ConvolutionStage.cpp
+    Zero-latency partitioned convolution with a background-computed tail.
+
+  ==============================================================================
+*/
+
+#include "ConvolutionStage.h"
+
+namespace
+{
+// accumulator += a * b over interleaved complex bins.
+void multiplyAccumulate (float* accumulator, const float* a, const float* b, int numBins) noexcept
+{
+    for (auto bin = 0; bin < 2 * numBins; bin += 2)
+    {
+        accumulator[bin]     += a[bin] * b[bin]     - a[bin + 1] * b[bin + 1];
+        accumulator[bin + 1] += a[bin] * b[bin + 1] + a[bin + 1] * b[bin];
+    }
+}
+
+int getNumPartitions (int numTaps, int partitionSize) noexcept
+{
+    return juce::jmax(0, (numTaps + partitionSize - 1) / partitionSize);
+}
+}
+
+static_assert (ConvolutionStage::tailSize % ConvolutionStage::headSize == 0, "tail frames end on head frame boundaries");
+
+// tail frames between the one written and the one played, so that a frame is never due within the host block
+// it was written in: the worker has at least one whole block period for it, whatever the block size.
+int getTailDelay (int maximumBlockSize) noexcept
+{
+    return 1 + juce::jmax(1, (maximumBlockSize + ConvolutionStage::tailSize - 1) / ConvolutionStage::tailSize);
+}
+
+//==============================================================================
+// uniformly partitioned overlap-save convolution: every frame of `size` samples is transformed once,
+// and its spectrum meets each partition of the impulse response through the frequency-domain delay line.
+class ConvolutionStage::Partitions
+{
+public:
+    Partitions (int partitionSize, int numPartitions, int numImpulseChannels, int numChannels)
+        : size (partitionSize),
+          count (numPartitions),
+          numBins (partitionSize + 1),
+          _fft (juce::roundToInt(std::log2(2.0 * partitionSize))),
+          _spectra (numImpulseChannels, juce::jmax(1, numPartitions * 2 * numBins)),
+          _delayLine (numChannels, juce::jmax(1, numPartitions * 2 * numBins))
+    {
+        _spectra.clear();
+        _delayLine.clear();
+    }
+
+    // the partitions of one impulse response channel; scratch holds 4 * size floats.
+    void setImpulseResponse (int impulseChannel, const float* taps, int numTaps, float* scratch) noexcept
+    {
+        auto* spectra = _spectra.getWritePointer(impulseChannel);
+
+        for (auto partition = 0; partition < count; ++partition)
+        {
+            // zero-padded to twice its length, so the valid half of each product is a linear convolution.
+            std::fill(scratch, scratch + 4 * size, 0.0f);
+            auto offset = partition * size;
+            std::copy(taps + offset, taps + juce::jmin(numTaps, offset + size), scratch);
+
+            _fft.performRealOnlyForwardTransform(scratch, true);
+            std::copy(scratch, scratch + 2 * numBins, spectra + partition * 2 * numBins);
+        }
+    }
+
+    // input is the previous and the current frame (2 * size), output the next `size` samples.
+    void process (int channel, int impulseChannel, const float* input, float* output, float* scratch) noexcept
+    {
+        std::copy(input, input + 2 * size, scratch);
+        _fft.performRealOnlyForwardTransform(scratch, true);
+
+        auto* delayLine = _delayLine.getWritePointer(channel);
+        std::copy(scratch, scratch + 2 * numBins, delayLine + _position * 2 * numBins);
+
+        std::fill(scratch, scratch + 4 * size, 0.0f);
+        auto* spectra = _spectra.getReadPointer(impulseChannel);
+        for (auto partition = 0; partition < count; ++partition)
+        {
+            auto slot = (_position - partition + count) % count;
+            multiplyAccumulate(scratch, delayLine + slot * 2 * numBins, spectra + partition * 2 * numBins, numBins);
+        }
+
+        _fft.performRealOnlyInverseTransform(scratch);
+        std::copy(scratch + size, scratch + 2 * size, output);
+    }
+
+    // move to the next frame (after every channel has processed the current one).
+    void advance() noexcept
+    {
+        _position = (_position + 1) % count;
+    }
+
+    void clear() noexcept
+    {
+        _delayLine.clear();
+        _position = 0;
+    }
+
+    const int size;
+    const int count;
+    const int numBins;
+
+private:
+    juce::dsp::FFT _fft;
+    juce::AudioBuffer<float> _spectra;      // impulse response channel x partitions
+    juce::AudioBuffer<float> _delayLine;    // channel x past frames
+    int _position = 0;
+};
+
+//==============================================================================
+class ConvolutionStage::Engine
+{
+public:
+    Engine (const juce::AudioBuffer<float>& impulseResponse, int numChannels, int maximumBlockSize, bool computeTailInline,
+            std::atomic<juce::int64>& lateFrames)
+        : _computeTailInline (computeTailInline),
+          _numChannels (juce::jmax(1, numChannels)),
+          _numImpulseChannels (juce::jmax(1, impulseResponse.getNumChannels())),
+          _numDirectTaps (juce::jmin(headSize, impulseResponse.getNumSamples())),
+          _tailDelay (getTailDelay(maximumBlockSize)),
+          _tailStart (_tailDelay * tailSize),
+          _numTailSlots (_tailDelay + 2),
+          _head (headSize, getNumPartitions(juce::jmin(impulseResponse.getNumSamples(), _tailStart) - headSize, headSize), _numImpulseChannels, _numChannels),
+          _tail (tailSize, getNumPartitions(impulseResponse.getNumSamples() - _tailStart, tailSize), _numImpulseChannels, _numChannels),
+          _tailInput ((size_t) _numTailSlots + 1),
+          _tailOutput ((size_t) _numTailSlots),
+          _lateFrames (lateFrames)
+    {
+        auto length = impulseResponse.getNumSamples();
+
+        _directTaps.setSize(_numImpulseChannels, headSize);
+        _directTaps.clear();
+        _directHistory.setSize(_numChannels, 2 * headSize);
+        _headInput.setSize(_numChannels, 2 * headSize);
+        _headOutput.setSize(_numChannels, headSize);
+        _headScratch.allocate(4 * headSize, true);
+
+        _tailFrame.setSize(_numChannels, 2 * tailSize);
+        _tailFrame.clear();
+        for (auto slot = 0; slot < _numTailSlots; ++slot)
+        {
+            _tailInput[(size_t) slot].setSize(_numChannels, tailSize);
+            _tailInput[(size_t) slot].clear();
+            _tailOutput[(size_t) slot].setSize(_numChannels, tailSize);
+        }
+        _tailInput[(size_t) _numTailSlots].setSize(_numChannels, tailSize);
+        _tailScratch.allocate(4 * tailSize, true);
+
+        for (auto channel = 0; channel < impulseResponse.getNumChannels(); ++channel)
+        {
+            auto* taps = impulseResponse.getReadPointer(channel);
+            _directTaps.copyFrom(channel, 0, taps, _numDirectTaps);
+
+            if (_head.count > 0)
+                _head.setImpulseResponse(channel, taps + headSize, juce::jmin(length, _tailStart) - headSize, _tailScratch.get());
+
+            if (_tail.count > 0)
+                _tail.setImpulseResponse(channel, taps + _tailStart, length - _tailStart, _tailScratch.get());
+        }
+
+        clearState();
+    }
+
+    // drop the history (audio thread); the worker drops the tail's history when it sees the new generation.
+    void reset() noexcept
+    {
+        clearState();
+        restartTail(_tailFrames);
+    }
+
+    template <typename SampleType>
+    void process (SampleType* const* channels, int numChannels, int startSample, int numSamples) noexcept
+    {
+        numChannels = juce::jmin(numChannels, _numChannels);
+
+        // run up to the next head frame boundary (tail frames are whole numbers of head frames).
+        for (auto done = 0; done < numSamples;)
+        {
+            auto length = juce::jmin(numSamples - done, headSize - _headPosition);
+
+            // the tail frame written _tailDelay frames ago plays now, if the worker made it in time.
+            auto readFrame = _tailFrames - _tailDelay;
+            auto captureSlot = _tailCapturing ? (size_t) (_tailFrames % _numTailSlots) : (size_t) _numTailSlots;
+
+            for (auto channel = 0; channel < numChannels; ++channel)
+            {
+                auto* data = channels[channel] + startSample + done;
+                auto* taps = _directTaps.getReadPointer(getImpulseChannel(channel));
+                auto* history = _directHistory.getWritePointer(channel);
+                auto* headInput = _headInput.getWritePointer(channel, headSize + _headPosition);
+                auto* headOutput = _headOutput.getReadPointer(channel, _headPosition);
+                auto* tailInput = _tailInput[captureSlot].getWritePointer(channel, _tailPosition);
+                auto* tailOutput = _tailPlaying ? _tailOutput[(size_t) (readFrame % _numTailSlots)].getReadPointer(channel, _tailPosition) : nullptr;
+
+                for (auto i = 0, position = _directPosition; i < length; ++i)
+                {
+                    auto input = (float) data[i];
+
+                    // the history is stored twice, so the newest headSize samples are always contiguous.
+                    history[position] = history[position + headSize] = input;
+
+                    auto output = headOutput[i];
+                    for (auto tap = 0; tap < _numDirectTaps; ++tap)
+                        output += taps[tap] * history[position + tap];
+
+                    if (tailOutput != nullptr)
+                        output += tailOutput[i];
+
+                    headInput[i] = input;
+                    tailInput[i] = input;
+                    data[i] = (SampleType) output;
+
+                    position = (position == 0 ? headSize : position) - 1;
+                }
+            }
+
+            _directPosition = ((_directPosition - length) % headSize + headSize) % headSize;
+            _headPosition += length;
+            _tailPosition += length;
+            done += length;
+
+            if (_headPosition == headSize)
+                processHeadFrame();
+
+            if (_tailPosition == tailSize)
+                finishTailFrame();
+        }
+    }
+
+    // compute the next posted tail frame (worker thread); false when there is nothing to do.
+    bool runTailFrame() noexcept
+    {
+        // posted before the generation: a frame posted after a restart is only ever seen together with it.
+        auto posted = _postedFrames.load(std::memory_order_acquire);
+        auto generation = _generation.load(std::memory_order_acquire);
+
+        if (generation != _workerGeneration)
+        {
+            _workerGeneration = generation;
+            _workerStartFrame = _generationStartFrame.load(std::memory_order_relaxed);
+            _tailFrame.clear();
+            _tail.clear();
+        }
+
+        auto next = _completedFrames.load(std::memory_order_relaxed);
+        if (next >= posted)
+            return false;
+
+        // frames from before the restart are never played, so they are passed over without reading their input.
+        if (next < _workerStartFrame)
+        {
+            _completedFrames.store(juce::jmin(posted, _workerStartFrame), std::memory_order_release);
+            return true;
+        }
+
+        processTailFrame(next);
+        _completedFrames.store(next + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    int getImpulseChannel (int channel) const noexcept
+    {
+        return juce::jmin(channel, _numImpulseChannels - 1);
+    }
+
+    void clearState() noexcept
+    {
+        _directHistory.clear();
+        _directPosition = 0;
+
+        _headInput.clear();
+        _headOutput.clear();
+        _head.clear();
+        _headPosition = 0;
+
+        // the tail slots and partitions may still be in the worker's hands; it clears its own state.
+        _tailPosition = 0;
+        _tailPlaying = false;
+    }
+
+    // frames from startFrame on start from silence (audio thread).
+    void restartTail (juce::int64 startFrame) noexcept
+    {
+        _tailStartFrame = startFrame;
+        _generationStartFrame.store(startFrame, std::memory_order_relaxed);
+        _generation.fetch_add(1, std::memory_order_release);
+    }
+
+    void processHeadFrame() noexcept
+    {
+        _headPosition = 0;
+        if (_head.count == 0)
+            return;
+
+        for (auto channel = 0; channel < _numChannels; ++channel)
+        {
+            auto* input = _headInput.getWritePointer(channel);
+            _head.process(channel, getImpulseChannel(channel), input, _headOutput.getWritePointer(channel), _headScratch.get());
+
+            // this frame is the first half of the next one.
+            std::copy(input + headSize, input + 2 * headSize, input);
+        }
+
+        _head.advance();
+    }
+
+    void finishTailFrame() noexcept
+    {
+        _tailPosition = 0;
+        if (_tail.count == 0)
+            return;
+
+        // a frame whose input could not be kept breaks the tail's history, so it starts over after it.
+        auto frame = _tailFrames;
+        if (! _tailCapturing)
+            restartTail(frame + 1);
+
+        _postedFrames.store(frame + 1, std::memory_order_release);
+        _tailFrames = frame + 1;
+
+        // offline, the frame is computed right here, so the output never depends on how the worker is scheduled.
+        if (_computeTailInline)
+            while (runTailFrame()) {}
+
+        // the audio thread never waits for the worker: a frame not finished by now plays as silence,
+        // and the next frame's input is dropped while the worker still reads that slot.
+        auto completed = _completedFrames.load(std::memory_order_acquire);
+        auto readFrame = _tailFrames - _tailDelay;
+        _tailPlaying = readFrame >= _tailStartFrame && completed > readFrame;
+        _tailCapturing = completed > _tailFrames - _numTailSlots;
+
+        if (readFrame >= _tailStartFrame && ! _tailPlaying)
+            _lateFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void processTailFrame (juce::int64 frame) noexcept
+    {
+        auto slot = (size_t) (frame % _numTailSlots);
+
+        for (auto channel = 0; channel < _numChannels; ++channel)
+        {
+            auto* input = _tailFrame.getWritePointer(channel);
+            std::copy(_tailInput[slot].getReadPointer(channel), _tailInput[slot].getReadPointer(channel) + tailSize, input + tailSize);
+
+            _tail.process(channel, getImpulseChannel(channel), input, _tailOutput[slot].getWritePointer(channel), _tailScratch.get());
+            std::copy(input + tailSize, input + 2 * tailSize, input);
+        }
+
+        _tail.advance();
+    }
+
+    const bool _computeTailInline;      // tail frames on the audio thread (non-realtime rendering, no worker)
+    const int _numChannels;
+    const int _numImpulseChannels;
+    const int _numDirectTaps;
+    const int _tailDelay;               // frames from writing a tail frame to playing its result
+    const int _tailStart;               // first tap of the tail partitions
+    const int _numTailSlots;            // the frame written, the _tailDelay frames before it, and one frame of slack
+
+    // direct convolution of the first headSize taps (audio thread)
+    juce::AudioBuffer<float> _directTaps;
+    juce::AudioBuffer<float> _directHistory;
+    int _directPosition = 0;
+
+    // head partitions (audio thread)
+    Partitions _head;
+    juce::AudioBuffer<float> _headInput;    // previous and current frame
+    juce::AudioBuffer<float> _headOutput;   // result played during the current frame
+    juce::HeapBlock<float> _headScratch;
+    int _headPosition = 0;
+
+    // tail partitions: the audio thread fills and plays the slots, the worker computes the frames in order
+    Partitions _tail;
+    std::vector<juce::AudioBuffer<float>> _tailInput;       // the extra slot takes input that is dropped
+    std::vector<juce::AudioBuffer<float>> _tailOutput;
+    int _tailPosition = 0;
+    juce::int64 _tailFrames = 0;            // frames written by the audio thread
+    juce::int64 _tailStartFrame = 0;        // first frame of the current generation
+    bool _tailPlaying = false;              // the frame played now was finished in time
+    bool _tailCapturing = true;             // the frame written now has a free slot
+
+    // the worker serving the stage only (one at a time)
+    juce::AudioBuffer<float> _tailFrame;    // previous and current frame
+    juce::HeapBlock<float> _tailScratch;
+    juce::uint32 _workerGeneration = 0;
+    juce::int64 _workerStartFrame = 0;
+
+    std::atomic<juce::int64> _postedFrames { 0 };
+    std::atomic<juce::int64> _completedFrames { 0 };
+    std::atomic<juce::uint32> _generation { 0 };            // bumped by every restart of the tail
+    std::atomic<juce::int64> _generationStartFrame { 0 };
+
+    std::atomic<juce::int64>& _lateFrames;                  // the stage's count of frames played as silence
+};
+
+//==============================================================================
+class ConvolutionStage::Loader  : public juce::Thread
+{
+public:
+    explicit Loader (ConvolutionStage& owner)
+        : juce::Thread ("Impulse response loader"), _owner (owner)
+    {
+    }
+
+    // one pass per request; loadImpulseResponse starts the thread again for the next one.
+    void run() override
+    {
+        if (_owner._loadRequested.exchange(false))
+            _owner.readRequestedFile();
+
+        if (_owner._buildRequested.exchange(false))
+            _owner.buildEngine();
+    }
+
+private:
+    ConvolutionStage& _owner;
+};
+
+//==============================================================================
+// a few workers serve every stage in the process: any idle one takes the next stage, and a stage is served by one
+// worker at a time, so a busy session spreads over the cores. they only run while some stage plays in realtime.
+class ConvolutionStage::TailWorkers
+{
+public:
+    TailWorkers()
+    {
+        // one core is left to the audio thread.
+        auto numWorkers = juce::jlimit(1, maximumWorkers, juce::SystemStats::getNumCpus() - 1);
+        for (auto i = 0; i < numWorkers; ++i)
+            _workers.add(new Worker(*this));
+    }
+
+    ~TailWorkers()
+    {
+        for (auto* worker : _workers)
+            worker->signalThreadShouldExit();
+
+        for (auto* worker : _workers)
+        {
+            worker->notify();
+            worker->stopThread(1000);
+        }
+    }
+
+    // a stage with an engine to serve (any thread but the audio thread).
+    void add (ConvolutionStage& stage)
+    {
+        const juce::ScopedLock lock(_stagesLock);
+        _stages.addIfNotAlreadyThere(&stage);
+
+        for (auto* worker : _workers)
+        {
+            // the tail has a deadline of one host block, so the workers run at the priority closest to the audio thread's.
+            if (! worker->isThreadRunning())
+                worker->startThread(juce::Thread::Priority::highest);
+
+            worker->notify();
+        }
+    }
+
+    // once this returns, no worker touches the stage or its engines.
+    void remove (ConvolutionStage& stage)
+    {
+        {
+            const juce::ScopedLock lock(_stagesLock);
+            _stages.removeFirstMatchingValue(&stage);
+        }
+
+        // a worker that claimed the stage before it was removed finishes its pass first.
+        while (stage._tailClaimed.load(std::memory_order_acquire))
+            juce::Thread::yield();
+    }
+
+private:
+    class Worker  : public juce::Thread
+    {
+    public:
+        explicit Worker (TailWorkers& owner)
+            : juce::Thread ("Convolution tail"), _owner (owner)
+        {
+        }
+
+        void run() override
+        {
+            _owner.run(*this);
+        }
+
+    private:
+        TailWorkers& _owner;
+    };
+
+    // one pass over the stages; false when no stage had a frame to compute.
+    bool serveStages (bool& hasStages) noexcept
+    {
+        auto busy = false;
+        hasStages = false;
+
+        for (auto index = 0;; ++index)
+        {
+            // claimed under the lock, so remove() only has to wait for claims made before it.
+            ConvolutionStage* stage = nullptr;
+            {
+                const juce::ScopedLock lock(_stagesLock);
+                if (index >= _stages.size())
+                    break;
+
+                hasStages = true;
+                if (_stages.getUnchecked(index)->_tailClaimed.exchange(true, std::memory_order_acq_rel))
+                    continue;
+
+                stage = _stages.getUnchecked(index);
+            }
+
+            if (auto* engine = stage->_activeEngine.load())
+                while (engine->runTailFrame())
+                    busy = true;
+
+            // only the worker holding the stage may still be using a retired engine, so it frees them.
+            delete stage->_retiredEngine.exchange(nullptr);
+            stage->_tailClaimed.store(false, std::memory_order_release);
+        }
+
+        return busy;
+    }
+
+    void run (Worker& worker)
+    {
+        auto lastBusyTime = juce::Time::getMillisecondCounter();
+
+        // poll instead of being notified, so that the audio thread never takes a lock;
+        // a tail frame has at least a whole host block of slack, far longer than the interval.
+        while (! worker.threadShouldExit())
+        {
+            auto hasStages = false;
+            auto busy = serveStages(hasStages);
+
+            auto now = juce::Time::getMillisecondCounter();
+            if (busy)
+                lastBusyTime = now;
+
+            // sleep until a stage is added; between blocks poll closely, and after a while without frames
+            // (cabinet off, transport stopped) more slowly, at the cost of a first frame that may play silent.
+            if (! hasStages)
+                worker.wait(-1);
+            else if (! busy)
+                worker.wait(now - lastBusyTime < idleDelayMilliseconds ? pollIntervalMilliseconds : idlePollIntervalMilliseconds);
+        }
+    }
+
+    static constexpr int maximumWorkers = 8;
+    static constexpr int pollIntervalMilliseconds = 1;
+    static constexpr int idlePollIntervalMilliseconds = 5;
+    static constexpr juce::uint32 idleDelayMilliseconds = 1000;
+
+    juce::CriticalSection _stagesLock;
+    juce::Array<ConvolutionStage*> _stages;
+    juce::OwnedArray<Worker> _workers;
+};
+
+//==============================================================================
+ConvolutionStage::ConvolutionStage()
+    : _loader (std::make_unique<Loader>(*this))
+{
+}
+
+ConvolutionStage::~ConvolutionStage()
+{
+    release();
+}
+
+void ConvolutionStage::prepare (double sampleRate, int numChannels, int maximumBlockSize, bool realtime)
+{
+    // the threads use the engines, so they must not run while those are replaced.
+    stopThreads();
+
+    auto formatChanged = sampleRate != _sampleRate || numChannels != _numChannels
+                      || maximumBlockSize != _maximumBlockSize || realtime != _realtime;
+    _sampleRate = sampleRate;
+    _numChannels = numChannels;
+    _maximumBlockSize = maximumBlockSize;
+    _realtime = realtime;
+    _lateFrames = 0;
+
+    // a file requested before playback is read here, so the first block already has it and renders repeat exactly.
+    if (_loadRequested.exchange(false))
+        readRequestedFile();
+
+    // no block runs meanwhile, so the engine is built and swapped in right here; for the same format it is kept.
+    if (formatChanged || _buildRequested.exchange(false))
+    {
+        delete _pendingEngine.exchange(nullptr);
+        replaceEngine(createEngine());
+    }
+    else if (auto* pending = _pendingEngine.exchange(nullptr))
+    {
+        replaceEngine(pending);
+    }
+
+    if (_engine != nullptr)
+        _engine->reset();
+
+    // the shared workers only serve stages that have something to play.
+    if (_realtime && _engine != nullptr)
+        _tailWorkers->add(*this);
+}
+
+void ConvolutionStage::release()
+{
+    stopThreads();
+
+    delete _pendingEngine.exchange(nullptr);
+    replaceEngine(nullptr);
+
+    // the next prepare builds the engine again.
+    _sampleRate = 0.0;
+}
+
+void ConvolutionStage::stopThreads()
+{
+    // a load in progress is finished first, so its engine is not built for the old format behind prepare's back.
+    _loader->waitForThreadToExit(-1);
+    _tailWorkers->remove(*this);
+}
+
+void ConvolutionStage::replaceEngine (Engine* engine)
+{
+    delete _retiredEngine.exchange(nullptr);
+    delete _engine;
+
+    _engine = engine;
+    _activeEngine = _realtime ? engine : nullptr;
+}
+
+void ConvolutionStage::loadImpulseResponse (const juce::File& file)
+{
+    {
+        const juce::ScopedLock lock(_sourceLock);
+        _requestedFile = file;
+    }
+
+    // while prepared, the loader reads it now (after a load still in progress); otherwise the next prepare does.
+    _loadRequested = true;
+    if (_sampleRate > 0.0)
+    {
+        _loader->waitForThreadToExit(-1);
+        _loader->startThread();
+    }
+}
+
+void ConvolutionStage::readRequestedFile()
+{
+    juce::File file;
+    {
+        const juce::ScopedLock lock(_sourceLock);
+        file = _requestedFile;
+    }
+
+    // a missing or unreadable file keeps the current impulse response.
+    if (! file.existsAsFile())
+        return;
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0)
+        return;
+
+    auto length = (int) juce::jmin(reader->lengthInSamples, (juce::int64) (maximumLength * reader->sampleRate));
+    juce::AudioBuffer<float> source((int) juce::jlimit(1u, 2u, reader->numChannels), length);
+    reader->read(&source, 0, length, 0, true, true);
+
+    {
+        const juce::ScopedLock lock(_sourceLock);
+        std::swap(_source, source);
+        _sourceSampleRate = reader->sampleRate;
+    }
+
+    _buildRequested = true;
+}
+
+void ConvolutionStage::buildEngine()
+{
+    // an engine the audio thread has not picked up yet is simply replaced.
+    if (auto* engine = createEngine())
+    {
+        delete _pendingEngine.exchange(engine);
+
+        if (_realtime)
+            _tailWorkers->add(*this);
+    }
+}
+
+ConvolutionStage::Engine* ConvolutionStage::createEngine()
+{
+    juce::AudioBuffer<float> source;
+    double sourceSampleRate;
+    {
+        const juce::ScopedLock lock(_sourceLock);
+        source.makeCopyOf(_source);
+        sourceSampleRate = _sourceSampleRate;
+    }
+
+    if (source.getNumSamples() == 0 || _sampleRate <= 0.0)
+        return nullptr;
+
+    // resample to the processing rate; a few zeros at the end keep the interpolator inside the buffer.
+    auto ratio = sourceSampleRate / _sampleRate;
+    auto length = juce::jmax(1, (int) std::ceil(source.getNumSamples() / ratio));
+    source.setSize(source.getNumChannels(), source.getNumSamples() + 8, true, true);
+
+    juce::AudioBuffer<float> impulseResponse(source.getNumChannels(), length);
+    for (auto channel = 0; channel < source.getNumChannels(); ++channel)
+    {
+        juce::LagrangeInterpolator interpolator;
+        interpolator.process(ratio, source.getReadPointer(channel), impulseResponse.getWritePointer(channel), length);
+    }
+
+    // unit energy in the loudest channel, so that cabinets of any length play at a similar level.
+    auto energy = 0.0;
+    for (auto channel = 0; channel < impulseResponse.getNumChannels(); ++channel)
+    {
+        auto channelEnergy = 0.0;
+        auto* taps = impulseResponse.getReadPointer(channel);
+        for (auto i = 0; i < length; ++i)
+            channelEnergy += (double) taps[i] * taps[i];
+
+        energy = juce::jmax(energy, channelEnergy);
+    }
+
+    if (energy > 0.0)
+        impulseResponse.applyGain((float) (1.0 / std::sqrt(energy)));
+
+    return new Engine(impulseResponse, _numChannels, _maximumBlockSize, ! _realtime, _lateFrames);
+}
+
+void ConvolutionStage::adoptPendingEngine() noexcept
+{
+    // wait until the worker has freed the previous engine, so no engine is ever freed here.
+    if (_pendingEngine.load() == nullptr || _retiredEngine.load() != nullptr)
+        return;
+
+    auto* next = _pendingEngine.exchange(nullptr);
+    _activeEngine.store(_realtime ? next : nullptr);
+    _retiredEngine.store(_engine);
+    _engine = next;
+}
+
+bool ConvolutionStage::isReady() const noexcept
+{
+    return _engine != nullptr || _pendingEngine.load() != nullptr;
+}
+
+juce::int64 ConvolutionStage::getNumLateTailFrames() const noexcept
+{
+    return _lateFrames.load(std::memory_order_relaxed);
+}
+
+void ConvolutionStage::reset() noexcept
+{
+    if (_engine != nullptr)
+        _engine->reset();
+}
+
+template <typename SampleType>
+void ConvolutionStage::process (juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numChannels) noexcept
+{
+    adoptPendingEngine();
+
+    // no impulse response yet: the signal passes unchanged.
+    if (_engine == nullptr)
+        return;
+
+    _engine->process(buffer.getArrayOfWritePointers(), juce::jmin(numChannels, buffer.getNumChannels()), startSample, numSamples);
+}
+
+template void ConvolutionStage::process<float> (juce::AudioBuffer<float>&, int, int, int) noexcept;
+template void ConvolutionStage::process<double> (juce::AudioBuffer<double>&, int, int, int) noexcept;
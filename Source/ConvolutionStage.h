@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    ConvolutionStage.h
+    Zero-latency partitioned convolution with a background-computed tail.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// CpX̕ (tailStart = (1 + ceil(őubNTCY / tailSize)) * tailSizeAŏ 2 * tailSize)
+//   [0, headSize)              ԗ̈̒ڏݍ (CeV[)
+//   [headSize, tailStart)      headSize ƂFFTݍ (I[fBIXbh)
+//   [tailStart, )          tailSize ƂFFTݍ ([J[Xbh)
+//                              t[͏񂾃ubÑubNōĐ̂ŁAȂƂ1ubN̗P\
+//                              I[fBIXbh͑҂AԂɍȂt[͖ɂ
+class ConvolutionStage
+{
+public:
+    // TCY(Tv)
+    static constexpr int headSize = 64;
+    static constexpr int tailSize = 1024;
+
+    // ǂݍރCpX̍ő咷(b)
+    static constexpr double maximumLength = 2.0;
+
+    ConvolutionStage();
+    ~ConvolutionStage();
+
+    // ĐȌ (CpX̓ǂݍ݂ƃGW̍쐬̏ōsAŏ̃ubNݍ)
+    // maximumBlockSize ̓zXg1̏̍őTv (㔼n߂ʒu߂)
+    // Tv[gE`lEőubNTCYOƓꍇ̓GŴ܂܎g
+    // realtime  false ̏ꍇ͌㔼I[fBIXbhŌvZ (ItC̃_OŌʂɂ)
+    void prepare(double sampleRate, int numChannels, int maximumBlockSize, bool realtime);
+
+    // Xbh̒~ƃGW̉
+    void release();
+
+    // CpX̓ǂݍݗv (Đ͓ǂݍ݁ETvOȄʃXbhōsA
+    // ł܂ł͑ÕCpXg)
+    void loadImpulseResponse(const juce::File& file);
+
+    // GW̏łĂ邩 (prepare ̌Aprocess n߂OɊmF)
+    bool isReady() const noexcept;
+
+    // 㔼̌vZԂɍ킸ōĐt[ (prepare ̗݌vAǂ̃Xbhłǂ߂)
+    juce::int64 getNumLateTailFrames() const noexcept;
+
+    // ݍ݂̏Ԃ̃NA (I[fBIXbhĂԁA[J[Xbh҂Ȃ)
+    void reset() noexcept;
+
+    // ݍ (CpX̏ꍇ͉Ȃ)
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numChannels) noexcept;
+
+private:
+    class Partitions;
+    class Engine;
+    class Loader;
+    class TailWorkers;
+
+    // t@C̓ǂݍ݂ƁÃ݂Tv[gł̃GW̍쐬 (Loader  prepare Ă)
+    void readRequestedFile();
+    void buildEngine();
+    Engine* createEngine();
+
+    // Xbh̒~ƁAgp̃GW̒u (Xbh̒~̂)
+    void stopThreads();
+    void replaceEngine(Engine* engine);
+
+    // ς݂̃GWւ̐؂ւ (I[fBIXbh)
+    void adoptPendingEngine() noexcept;
+
+    double _sampleRate = 0.0;
+    int _numChannels = 0;
+    int _maximumBlockSize = 0;
+    bool _realtime = true;
+    std::atomic<juce::int64> _lateFrames { 0 };
+
+    // ǂݍ񂾃CpX (̃Tv[ĝ܂ܕێATv[g`lςƃGW蒼)
+    juce::CriticalSection _sourceLock;
+    juce::File _requestedFile;
+    juce::AudioBuffer<float> _source;
+    double _sourceSampleRate = 0.0;
+    std::atomic<bool> _loadRequested { false };
+    std::atomic<bool> _buildRequested { false };
+
+    // GW̎󂯓n (Loader -> I[fBIXbh -> TailWorkers ŉ)
+    Engine* _engine = nullptr;                          // I[fBIXbhgp
+    std::atomic<Engine*> _pendingEngine { nullptr };    // ς݂Ŗgp
+    std::atomic<Engine*> _activeEngine { nullptr };     // TailWorkers 㔼vZΏ
+    std::atomic<Engine*> _retiredEngine { nullptr };    // ҂
+
+    // ǂݍ݂͗vƂɋNA㔼̌vZ͑SCX^XCPURAɍ킹XbhL
+    // (1̃CX^X͓1̃XbhS)
+    std::unique_ptr<Loader> _loader;
+    juce::SharedResourcePointer<TailWorkers> _tailWorkers;
+    std::atomic<bool> _tailClaimed { false };           // S̃Xbh
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionStage)
+};
@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+
+    DistortionCore.h
+    Header-only clip / tanh / gain staging on raw sample spans (no JUCE).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "DistortionKernels.h"
+
+namespace DistortionCore
+{
+    // c݂̎ (ev[gőIATvƂ̕𖳂)
+    enum class Mode
+    {
+        HardClip,   // 臒lł̃n[hNbv
+        Tanh,       // XyV (tanh)
+    };
+
+    // XC_[l狁߂QC\
+    struct GainStaging
+    {
+        float inputGain = 1.0f;         // ̓QC (XC_[l2)
+        float outputGain = 2.0f;        // o̓QC (XC_[l2 * 2)
+        float gainDecibel = 0.0f;       // cݗ (dB)
+        float threshold = 1.0f;         // NbsO臒l
+        float inverseThreshold = 1.0f;  // 1 / threshold
+        float specialDrive = 0.0f;      // tanh ւ͔̓{ (gainDecibel / 2 * 5 / 2)
+    };
+
+    // XC_[l (In: 0`1.5AGain: 1`2AOut: 0`1.5) ̃QC\
+    inline GainStaging makeGainStaging(float inputVolume, float gain, float outputVolume) noexcept
+    {
+        GainStaging staging;
+
+        // volume sliders are squared gains.
+        staging.inputGain  = inputVolume * inputVolume;
+        staging.outputGain = outputVolume * outputVolume * 2.0f;
+
+        // gain to threshold (-100 dB is silence, as in juce::Decibels).
+        auto squaredGain = (double) gain * gain;
+        auto gainDecibel = squaredGain > 0.0 ? std::max(-100.0, 20.0 * std::log10(squaredGain)) : -100.0;
+        auto threshold   = gainDecibel < 100.0 ? std::pow(10.0, -gainDecibel * 0.05) : 0.0;
+
+        staging.gainDecibel      = (float) gainDecibel;
+        staging.threshold        = (float) threshold;
+        staging.inverseThreshold = (float) (1 / threshold);
+        staging.specialDrive     = (float) (gainDecibel / 2.0 * 5.0 / 2);
+        return staging;
+    }
+
+    // c݂̑OɊ|{ (n[hNbv臒l 1 ɂ{)
+    template <Mode mode>
+    inline float getDrive(const GainStaging& staging) noexcept
+    {
+        return mode == Mode::Tanh ? staging.specialDrive : staging.inverseThreshold;
+    }
+
+    // c݂̑OɊ|Ŝ̔{ (̓QC * {)
+    template <Mode mode>
+    inline float getPreGain(const GainStaging& staging) noexcept
+    {
+        return staging.inputGain * getDrive<mode>(staging);
+    }
+
+    // ̏ (͔{Əo̓QĆAvJn̒lEڕWlƃv̈ʒu)
+    // ṽTv̒l preGain + (targetPreGain - preGain) * rampPosition / rampLength (o̓QCl)
+    struct State
+    {
+        float preGain = 1.0f;
+        float targetPreGain = 1.0f;
+        float outputGain = 1.0f;
+        float targetOutputGain = 1.0f;
+        int rampPosition = 0;           // ̃Tṽv̈ʒu
+        int rampLength = 0;             // 0 ܂ rampPosition >= rampLength ̏ꍇ͖ڕWlň
+    };
+
+    // QC\ň̏
+    template <Mode mode>
+    inline State makeState(const GainStaging& staging) noexcept
+    {
+        auto preGain = getPreGain<mode>(staging);
+        return { preGain, preGain, staging.outputGain, staging.outputGain, 0, 0 };
+    }
+
+    // v
+    inline bool isRamping(const State& state) noexcept
+    {
+        return state.rampPosition < state.rampLength;
+    }
+
+    // offset Tv͔̓{Eo̓QC
+    inline float getPreGain(const State& state, int offset = 0) noexcept
+    {
+        auto position = state.rampPosition + offset;
+        if (position >= state.rampLength)
+            return state.targetPreGain;
+
+        return state.preGain + (state.targetPreGain - state.preGain) / (float) state.rampLength * (float) position;
+    }
+
+    inline float getOutputGain(const State& state, int offset = 0) noexcept
+    {
+        auto position = state.rampPosition + offset;
+        if (position >= state.rampLength)
+            return state.targetOutputGain;
+
+        return state.outputGain + (state.targetOutputGain - state.outputGain) / (float) state.rampLength * (float) position;
+    }
+
+    // ̃Tv̒lVڕWlւ̃vn߂ (rampLength  0 ̏ꍇ͑Ɉړ)
+    inline void setTarget(State& state, float targetPreGain, float targetOutputGain, int rampLength) noexcept
+    {
+        state.preGain = getPreGain(state);
+        state.outputGain = getOutputGain(state);
+        state.targetPreGain = targetPreGain;
+        state.targetOutputGain = targetOutputGain;
+        state.rampPosition = 0;
+        state.rampLength = std::max(0, rampLength);
+    }
+
+    template <Mode mode>
+    inline void setTarget(State& state, const GainStaging& staging, int rampLength) noexcept
+    {
+        setTarget(state, getPreGain<mode>(staging), staging.outputGain, rampLength);
+    }
+
+    // numSamples vi߂ (S`l1)
+    inline void advance(State& state, int numSamples) noexcept
+    {
+        state.rampPosition = std::min(state.rampLength, state.rampPosition + numSamples);
+    }
+
+    // {|̘c (臒l 1Afloat  tanh ߎAdouble  std::tanh)
+    template <Mode mode>
+    inline float shape(float x) noexcept
+    {
+        return mode == Mode::Tanh ? DistortionKernels::fastTanh(x) : std::min(std::max(x, -1.0f), 1.0f);
+    }
+
+    template <Mode mode>
+    inline double shape(double x) noexcept
+    {
+        return mode == Mode::Tanh ? std::tanh(x) : std::min(std::max(x, -1.0), 1.0);
+    }
+
+    namespace detail
+    {
+        // v̗LƂɓWJ[v
+        template <Mode mode, bool rampedPreGain, bool rampedOutputGain, typename SampleType>
+        inline void processSpan(SampleType* data, int numSamples,
+                                const float* preGainRamp, float preGain, const float* outputRamp, float outputGain) noexcept
+        {
+            for (auto i = 0; i < numSamples; ++i)
+            {
+                auto pre = (SampleType) (rampedPreGain ? preGainRamp[i] : preGain);
+                auto out = (SampleType) (rampedOutputGain ? outputRamp[i] : outputGain);
+                data[i] = shape<mode>(data[i] * pre) * out;
+            }
+        }
+    }
+
+    // ͔{  c  o̓QC1pXŏ (ramp  nullptr ̏ꍇ͒萔 gain)
+    template <Mode mode, typename SampleType>
+    inline void process(SampleType* data, int numSamples,
+                        const float* preGainRamp, float preGain, const float* outputRamp, float outputGain) noexcept
+    {
+        if (preGainRamp != nullptr && outputRamp != nullptr)
+            detail::processSpan<mode, true, true>(data, numSamples, preGainRamp, preGain, outputRamp, outputGain);
+        else if (preGainRamp != nullptr)
+            detail::processSpan<mode, true, false>(data, numSamples, preGainRamp, preGain, outputRamp, outputGain);
+        else if (outputRamp != nullptr)
+            detail::processSpan<mode, false, true>(data, numSamples, preGainRamp, preGain, outputRamp, outputGain);
+        else
+            detail::processSpan<mode, false, false>(data, numSamples, preGainRamp, preGain, outputRamp, outputGain);
+    }
+
+    namespace detail
+    {
+        // vTv (c͖ڕWlň)
+        inline int getRampSamples(const State& state, int numSamples) noexcept
+        {
+            return std::min(numSamples, std::max(0, state.rampLength - state.rampPosition));
+        }
+
+        // Ԃ̃v1`lWJ[v
+        template <Mode mode, bool rampedPreGain, bool rampedOutputGain, typename SampleType>
+        inline void processState(SampleType* data, int numSamples, const State& state) noexcept
+        {
+            // the same expressions as getPreGain / getOutputGain, with the steps taken out of the loop.
+            auto rampSamples = getRampSamples(state, numSamples);
+            auto preGainStep = (state.targetPreGain - state.preGain) / (float) std::max(1, state.rampLength);
+            auto outputGainStep = (state.targetOutputGain - state.outputGain) / (float) std::max(1, state.rampLength);
+
+            for (auto i = 0; i < rampSamples; ++i)
+            {
+                auto position = (float) (state.rampPosition + i);
+                auto pre = (SampleType) (rampedPreGain ? state.preGain + preGainStep * position : state.targetPreGain);
+                auto out = (SampleType) (rampedOutputGain ? state.outputGain + outputGainStep * position : state.targetOutputGain);
+                data[i] = shape<mode>(data[i] * pre) * out;
+            }
+
+            processSpan<mode, false, false>(data + rampSamples, numSamples - rampSamples, nullptr, state.targetPreGain, nullptr, state.targetOutputGain);
+        }
+
+        // o̓QC| (c݂J[lŏ)
+        inline void applyOutputGain(float* data, int numSamples, const State& state) noexcept
+        {
+            auto rampSamples = getRampSamples(state, numSamples);
+            auto outputGainStep = (state.targetOutputGain - state.outputGain) / (float) std::max(1, state.rampLength);
+
+            for (auto i = 0; i < rampSamples; ++i)
+                data[i] *= state.outputGain + outputGainStep * (float) (state.rampPosition + i);
+
+            for (auto i = rampSamples; i < numSamples; ++i)
+                data[i] *= state.targetOutputGain;
+        }
+    }
+
+    // Ԃ̃QC1`l (state ͐i߂ȂAS`ľ advance Ă)
+    template <Mode mode, typename SampleType>
+    inline void process(SampleType* data, int numSamples, const State& state) noexcept
+    {
+        auto rampedPreGain = isRamping(state) && state.preGain != state.targetPreGain;
+        auto rampedOutputGain = isRamping(state) && state.outputGain != state.targetOutputGain;
+
+        if (rampedPreGain && rampedOutputGain)
+            detail::processState<mode, true, true>(data, numSamples, state);
+        else if (rampedPreGain)
+            detail::processState<mode, true, false>(data, numSamples, state);
+        else if (rampedOutputGain)
+            detail::processState<mode, false, true>(data, numSamples, state);
+        else
+            detail::processSpan<mode, false, false>(data, numSamples, nullptr, state.targetPreGain, nullptr, state.targetOutputGain);
+    }
+
+    // ƓŁA͔{̋ԂCPUʃJ[lg (float ̂݁Adouble ̓J[lgȂ)
+    template <Mode mode>
+    inline void process(float* data, int numSamples, const State& state, const DistortionKernels::KernelSet& kernels) noexcept
+    {
+        auto preGain = state.targetPreGain;
+        if (isRamping(state) && state.preGain != preGain)
+        {
+            process<mode>(data, numSamples, state);
+            return;
+        }
+
+        if (mode == Mode::Tanh)
+        {
+            kernels.tanhShape(data, numSamples, preGain);
+            detail::applyOutputGain(data, numSamples, state);
+            return;
+        }
+
+        // clamp(x * p, -1, 1) * g == clamp(x, -1/p, 1/p) * p * g, so steady gains fold into the kernel;
+        // a ramping output gain, or a pre-gain of zero (no threshold), takes the plain loop.
+        if (isRamping(state) || preGain <= 0.0f)
+        {
+            process<mode>(data, numSamples, state);
+            return;
+        }
+
+        kernels.hardClip(data, numSamples, 1.0f / preGain, preGain * state.targetOutputGain);
+    }
+
+    template <Mode mode>
+    inline void process(double* data, int numSamples, const State& state, const DistortionKernels::KernelSet&) noexcept
+    {
+        process<mode>(data, numSamples, state);
+    }
+}
@@ -0,0 +1,262 @@
+/*
+  ==============================================================================
+
+    DistortionKernels.cpp
+    Vectorized clipping / waveshaping kernels.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "DistortionKernels.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #if JUCE_GCC || JUCE_CLANG
+  #define DISTORTION_TARGET_AVX2 __attribute__ ((target ("avx2,fma")))
+ #else
+  #define DISTORTION_TARGET_AVX2
+ #endif
+#elif JUCE_ARM && (defined (__ARM_NEON__) || defined (__ARM_NEON))
+ #include <arm_neon.h>
+ #define DISTORTION_USE_NEON 1
+#endif
+
+namespace DistortionKernels
+{
+//==============================================================================
+// scalar.
+static void hardClipScalar (float* data, int numSamples, float threshold, float makeup)
+{
+    for (auto i = 0; i < numSamples; ++i)
+        data[i] = std::min(std::max(data[i], -threshold), threshold) * makeup;
+}
+
+static void tanhShapeScalar (float* data, int numSamples, float drive)
+{
+    for (auto i = 0; i < numSamples; ++i)
+        data[i] = fastTanh(data[i] * drive);
+}
+
+#if JUCE_INTEL
+//==============================================================================
+// sse.
+static inline __m128 fastTanhSSE (__m128 x)
+{
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-tanhClampRange)), _mm_set1_ps(tanhClampRange));
+    const auto x2 = _mm_mul_ps(x, x);
+
+    auto p = _mm_set1_ps(-2.76076847742355e-16f);
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(2.00018790482477e-13f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-8.60467152213735e-11f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(5.12229709037114e-08f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.48572235717979e-05f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(6.37261928875436e-04f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(4.89352455891786e-03f));
+
+    auto q = _mm_set1_ps(1.19825839466702e-06f);
+    q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(1.18534705686654e-04f));
+    q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(2.26843463243900e-03f));
+    q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(4.89352518554385e-03f));
+
+    return _mm_div_ps(_mm_mul_ps(x, p), q);
+}
+
+static void hardClipSSE (float* data, int numSamples, float threshold, float makeup)
+{
+    const auto hi = _mm_set1_ps(threshold);
+    const auto lo = _mm_set1_ps(-threshold);
+    const auto gain = _mm_set1_ps(makeup);
+
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(data + i), lo), hi), gain));
+
+    hardClipScalar(data + i, numSamples - i, threshold, makeup);
+}
+
+static void tanhShapeSSE (float* data, int numSamples, float drive)
+{
+    const auto d = _mm_set1_ps(drive);
+
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+        _mm_storeu_ps(data + i, fastTanhSSE(_mm_mul_ps(_mm_loadu_ps(data + i), d)));
+
+    tanhShapeScalar(data + i, numSamples - i, drive);
+}
+
+//==============================================================================
+// avx2 + fma.
+DISTORTION_TARGET_AVX2 static inline __m256 fastTanhAVX2 (__m256 x)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-tanhClampRange)), _mm256_set1_ps(tanhClampRange));
+    const auto x2 = _mm256_mul_ps(x, x);
+
+    auto p = _mm256_set1_ps(-2.76076847742355e-16f);
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(2.00018790482477e-13f));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(-8.60467152213735e-11f));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(5.12229709037114e-08f));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(1.48572235717979e-05f));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(6.37261928875436e-04f));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(4.89352455891786e-03f));
+
+    auto q = _mm256_set1_ps(1.19825839466702e-06f);
+    q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(1.18534705686654e-04f));
+    q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(2.26843463243900e-03f));
+    q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(4.89352518554385e-03f));
+
+    return _mm256_div_ps(_mm256_mul_ps(x, p), q);
+}
+
+DISTORTION_TARGET_AVX2 static void hardClipAVX2 (float* data, int numSamples, float threshold, float makeup)
+{
+    const auto hi = _mm256_set1_ps(threshold);
+    const auto lo = _mm256_set1_ps(-threshold);
+    const auto gain = _mm256_set1_ps(makeup);
+
+    auto i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+        _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(data + i), lo), hi), gain));
+
+    hardClipScalar(data + i, numSamples - i, threshold, makeup);
+}
+
+DISTORTION_TARGET_AVX2 static void tanhShapeAVX2 (float* data, int numSamples, float drive)
+{
+    const auto d = _mm256_set1_ps(drive);
+
+    auto i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+        _mm256_storeu_ps(data + i, fastTanhAVX2(_mm256_mul_ps(_mm256_loadu_ps(data + i), d)));
+
+    tanhShapeScalar(data + i, numSamples - i, drive);
+}
+#endif
+
+#if DISTORTION_USE_NEON
+//==============================================================================
+// neon.
+static inline float32x4_t fastTanhNEON (float32x4_t x)
+{
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-tanhClampRange)), vdupq_n_f32(tanhClampRange));
+    const auto x2 = vmulq_f32(x, x);
+
+    auto p = vdupq_n_f32(-2.76076847742355e-16f);
+    p = vmlaq_f32(vdupq_n_f32(2.00018790482477e-13f), p, x2);
+    p = vmlaq_f32(vdupq_n_f32(-8.60467152213735e-11f), p, x2);
+    p = vmlaq_f32(vdupq_n_f32(5.12229709037114e-08f), p, x2);
+    p = vmlaq_f32(vdupq_n_f32(1.48572235717979e-05f), p, x2);
+    p = vmlaq_f32(vdupq_n_f32(6.37261928875436e-04f), p, x2);
+    p = vmlaq_f32(vdupq_n_f32(4.89352455891786e-03f), p, x2);
+
+    auto q = vdupq_n_f32(1.19825839466702e-06f);
+    q = vmlaq_f32(vdupq_n_f32(1.18534705686654e-04f), q, x2);
+    q = vmlaq_f32(vdupq_n_f32(2.26843463243900e-03f), q, x2);
+    q = vmlaq_f32(vdupq_n_f32(4.89352518554385e-03f), q, x2);
+
+    // one reciprocal estimate refined by two newton steps keeps the error below the scalar bound.
+    auto r = vrecpeq_f32(q);
+    r = vmulq_f32(vrecpsq_f32(q, r), r);
+    r = vmulq_f32(vrecpsq_f32(q, r), r);
+    return vmulq_f32(vmulq_f32(x, p), r);
+}
+
+static void hardClipNEON (float* data, int numSamples, float threshold, float makeup)
+{
+    const auto hi = vdupq_n_f32(threshold);
+    const auto lo = vdupq_n_f32(-threshold);
+
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+        vst1q_f32(data + i, vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(data + i), lo), hi), makeup));
+
+    hardClipScalar(data + i, numSamples - i, threshold, makeup);
+}
+
+static void tanhShapeNEON (float* data, int numSamples, float drive)
+{
+    auto i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+        vst1q_f32(data + i, fastTanhNEON(vmulq_n_f32(vld1q_f32(data + i), drive)));
+
+    tanhShapeScalar(data + i, numSamples - i, drive);
+}
+#endif
+
+//==============================================================================
+const KernelSet& getScalarKernels() noexcept
+{
+    static const KernelSet kernels { "Scalar", hardClipScalar, tanhShapeScalar };
+    return kernels;
+}
+
+bool verifyKernels (const KernelSet& kernels) noexcept
+{
+    // odd length so that the scalar tail of every kernel is exercised too.
+    constexpr auto numSamples = 1023;
+    constexpr auto hardClipTolerance = 1.0e-6;
+    constexpr auto tanhTolerance = 2.0e-6;
+
+    float input[numSamples];
+    float output[numSamples];
+    for (auto i = 0; i < numSamples; ++i)
+        input[i] = -4.0f + 8.0f * (float) i / (float) (numSamples - 1);
+
+    // same range as the Gain parameter (1.0 ~ 2.0).
+    for (auto gain = 1.0; gain <= 2.0; gain += 0.125)
+    {
+        auto gainDecibel = juce::Decibels::gainToDecibels(gain * gain);
+        auto threshold = juce::Decibels::decibelsToGain(gainDecibel * -1.0);
+
+        std::copy(input, input + numSamples, output);
+        kernels.hardClip(output, numSamples, (float) threshold, (float) (1 / threshold));
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            auto expected = juce::jlimit(-threshold, threshold, (double) input[i]) * (1 / threshold);
+            if (std::abs(expected - output[i]) > hardClipTolerance * std::abs(expected) + hardClipTolerance)
+                return false;
+        }
+
+        std::copy(input, input + numSamples, output);
+        kernels.tanhShape(output, numSamples, (float) (gainDecibel / 2.0 * 5.0 / 2));
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            auto expected = tanh(5.0 * (input[i] * (gainDecibel / 2.0)) / 2);
+            if (std::abs(expected - output[i]) > tanhTolerance)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static const KernelSet& selectKernels() noexcept
+{
+   #if JUCE_INTEL
+    static const KernelSet avx2Kernels { "AVX2", hardClipAVX2, tanhShapeAVX2 };
+    static const KernelSet sseKernels  { "SSE",  hardClipSSE,  tanhShapeSSE };
+
+    if (juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3() && verifyKernels(avx2Kernels))
+        return avx2Kernels;
+
+    if (juce::SystemStats::hasSSE2() && verifyKernels(sseKernels))
+        return sseKernels;
+   #elif DISTORTION_USE_NEON
+    static const KernelSet neonKernels { "NEON", hardClipNEON, tanhShapeNEON };
+
+    if (juce::SystemStats::hasNeon() && verifyKernels(neonKernels))
+        return neonKernels;
+   #endif
+
+    jassert(verifyKernels(getScalarKernels()));
+    return getScalarKernels();
+}
+
+const KernelSet& getBestKernels() noexcept
+{
+    // resolved once per process, the first time a processor is created.
+    static const KernelSet& kernels = selectKernels();
+    return kernels;
+}
+}
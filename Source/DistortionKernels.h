@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    DistortionKernels.h
+    Vectorized clipping / waveshaping kernels.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+
+namespace DistortionKernels
+{
+    // tanhLߎ̃Nv͈ (̊Oł float  }1 Ɋۂ܂)
+    constexpr float tanhClampRange = 7.90531110763549805f;
+
+    // tanhLߎ (q13/6Aő덷 1e-6)
+    inline float fastTanh(float x) noexcept
+    {
+        x = std::min(std::max(x, -tanhClampRange), tanhClampRange);
+        const auto x2 = x * x;
+
+        auto p = -2.76076847742355e-16f;
+        p = p * x2 + 2.00018790482477e-13f;
+        p = p * x2 - 8.60467152213735e-11f;
+        p = p * x2 + 5.12229709037114e-08f;
+        p = p * x2 + 1.48572235717979e-05f;
+        p = p * x2 + 6.37261928875436e-04f;
+        p = p * x2 + 4.89352455891786e-03f;
+
+        auto q = 1.19825839466702e-06f;
+        q = q * x2 + 1.18534705686654e-04f;
+        q = q * x2 + 2.26843463243900e-03f;
+        q = q * x2 + 4.89352518554385e-03f;
+
+        return (x * p) / q;
+    }
+
+    // n[hNbv: data = clamp(data, -threshold, threshold) * makeup
+    using HardClipFunction = void (*)(float* data, int numSamples, float threshold, float makeup);
+
+    // XyV: data = tanh(data * drive)
+    using TanhShapeFunction = void (*)(float* data, int numSamples, float drive);
+
+    // ߃ZbgƂ̃J[lꎮ
+    struct KernelSet
+    {
+        const char* name;
+        HardClipFunction hardClip;
+        TanhShapeFunction tanhShape;
+    };
+
+    // XJ[ŃJ[l (Sŗp\)
+    const KernelSet& getScalarKernels() noexcept;
+
+    // sCPUŗp\؍ς݂̍őJ[l
+    const KernelSet& getBestKernels() noexcept;
+
+    // J[l̏o͂]̃XJ[Ɣr
+    bool verifyKernels(const KernelSet& kernels) noexcept;
+}
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    DspLoadMeter.cpp
+    processBlock time against the block's real-time deadline.
+
+  ==============================================================================
+*/
+
+#include "DspLoadMeter.h"
+
+void DspLoadMeter::prepare (double sampleRate) noexcept
+{
+    _sampleRatePerTick = sampleRate / (double) juce::Time::getHighResolutionTicksPerSecond();
+    _writeIndex.store(0);
+}
+
+void DspLoadMeter::setEnabled (bool shouldBeEnabled) noexcept
+{
+    _enabled.store(shouldBeEnabled);
+}
+
+void DspLoadMeter::push (juce::int64 elapsedTicks, int numSamples) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    // elapsed seconds / (numSamples / sampleRate)
+    auto load = (float) ((double) elapsedTicks * _sampleRatePerTick / numSamples);
+
+    auto index = _writeIndex.load(std::memory_order_relaxed);
+    _loads[index & (ringSize - 1)].store(load, std::memory_order_relaxed);
+    _writeIndex.store(index + 1, std::memory_order_release);
+}
+
+DspLoadMeter::Statistics DspLoadMeter::getStatistics() const
+{
+    Statistics statistics;
+
+    // entries may be overwritten while they are copied; each one is still a whole value.
+    auto written = _writeIndex.load(std::memory_order_acquire);
+    auto numBlocks = (int) juce::jmin(written, (juce::uint32) ringSize);
+    if (numBlocks == 0)
+        return statistics;
+
+    std::array<float, ringSize> loads;
+    for (auto i = 0; i < numBlocks; ++i)
+        loads[(size_t) i] = _loads[(written - 1 - (juce::uint32) i) & (ringSize - 1)].load(std::memory_order_relaxed);
+
+    std::sort(loads.begin(), loads.begin() + numBlocks);
+
+    auto sum = 0.0;
+    for (auto i = 0; i < numBlocks; ++i)
+        sum += loads[(size_t) i];
+
+    auto percentile = [&] (float fraction) { return loads[(size_t) juce::jmin(numBlocks - 1, (int) (fraction * (float) numBlocks))]; };
+
+    statistics.numBlocks    = numBlocks;
+    statistics.minimum      = loads[0];
+    statistics.average      = (float) (sum / numBlocks);
+    statistics.maximum      = loads[(size_t) numBlocks - 1];
+    statistics.percentile95 = percentile(0.95f);
+    statistics.percentile99 = percentile(0.99f);
+    return statistics;
+}
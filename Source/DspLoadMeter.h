@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    DspLoadMeter.h
+    processBlock time against the block's real-time deadline.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// 0 ɂƌvRpCꂸAI[o[wbh̓[ɂȂ
+#ifndef DISTORTION_LOAD_METER
+ #define DISTORTION_LOAD_METER 1
+#endif
+
+class DspLoadMeter
+{
+public:
+    // ߃ubN̕דv (1.0 = ubNƓ)
+    struct Statistics
+    {
+        int numBlocks = 0;
+        float minimum = 0.0f;
+        float average = 0.0f;
+        float maximum = 0.0f;
+        float percentile95 = 0.0f;
+        float percentile99 = 0.0f;
+    };
+
+    // vgݍ܂Ă邩
+    static constexpr bool isCompiledIn() noexcept { return DISTORTION_LOAD_METER != 0; }
+
+    // ĐȌ (L^̃NA)
+    void prepare(double sampleRate) noexcept;
+
+    // v̗L/ (GfB^\Lɂ)
+    void setEnabled(bool shouldBeEnabled) noexcept;
+
+    // v
+    bool isActive() const noexcept { return isCompiledIn() && _enabled.load(std::memory_order_relaxed); }
+
+    // v̎擾 (UIXbhĂ)
+    Statistics getStatistics() const;
+
+    // processBlock 1񕪂̌v
+    class ScopedMeasurement
+    {
+    public:
+       #if DISTORTION_LOAD_METER
+        ScopedMeasurement(DspLoadMeter& meter, int numSamples) noexcept
+            : _meter(meter.isActive() ? &meter : nullptr),
+              _numSamples(numSamples),
+              _startTicks(_meter != nullptr ? juce::Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~ScopedMeasurement() noexcept
+        {
+            if (_meter != nullptr)
+                _meter->push(juce::Time::getHighResolutionTicks() - _startTicks, _numSamples);
+        }
+       #else
+        ScopedMeasurement(DspLoadMeter&, int) noexcept {}
+       #endif
+
+    private:
+       #if DISTORTION_LOAD_METER
+        DspLoadMeter* _meter;
+        int _numSamples;
+        juce::int64 _startTicks;
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedMeasurement)
+    };
+
+private:
+    // 1ubNׂ̕L^ (I[fBIXbĥ݁Await-free)
+    void push(juce::int64 elapsedTicks, int numSamples) noexcept;
+
+    // L^ubN (2ׂ̂)
+    static constexpr int ringSize = 256;
+
+    std::atomic<float> _loads[ringSize] {};
+    std::atomic<juce::uint32> _writeIndex { 0 };
+    std::atomic<bool> _enabled { false };
+    double _sampleRatePerTick = 0.0;   // sampleRate / ticksPerSecond
+};
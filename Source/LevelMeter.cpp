@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    LevelMeter.cpp
+    Peak / RMS / clip-ratio metering handed from the audio thread to the UI.
+
+  ==============================================================================
+*/
+
+#include "LevelMeter.h"
+
+void LevelMeter::prepare (double sampleRate) noexcept
+{
+    // ~10 ms per frame keeps the UI rate independent of the host block size.
+    _samplesPerFrame = juce::jmax(1, juce::roundToInt(sampleRate * 0.01));
+    _accumulating = {};
+    _fifo.reset();
+}
+
+void LevelMeter::setEnabled (bool shouldBeEnabled) noexcept
+{
+    // the UI thread is the only reader, so it may drop what was left from the last time it looked.
+    if (shouldBeEnabled && ! _enabled.load())
+        _fifo.finishedRead(_fifo.getNumReady());
+
+    _enabled.store(shouldBeEnabled);
+}
+
+template <typename SampleType>
+int LevelMeter::countClipped (const SampleType* data, int numSamples, const float* ramp, float gain) noexcept
+{
+    auto numClipped = 0;
+
+    if (ramp != nullptr)
+    {
+        for (auto i = 0; i < numSamples; ++i)
+            numClipped += std::abs(data[i] * (SampleType) ramp[i]) >= (SampleType) 1 ? 1 : 0;
+
+        return numClipped;
+    }
+
+    if (gain <= 0.0f)
+        return 0;
+
+    // compare against the threshold instead of scaling every sample.
+    const auto threshold = (SampleType) (1.0f / gain);
+    for (auto i = 0; i < numSamples; ++i)
+        numClipped += std::abs(data[i]) >= threshold ? 1 : 0;
+
+    return numClipped;
+}
+
+void LevelMeter::addClipped (int channel, int numClipped, int numSamples) noexcept
+{
+    if (! juce::isPositiveAndBelow(channel, maxChannels))
+        return;
+
+    _accumulating.numClipped[channel] += numClipped;
+    _accumulating.numShaped[channel] += numSamples;
+}
+
+template <typename SampleType>
+void LevelMeter::measureOutput (const juce::AudioBuffer<SampleType>& buffer, int numChannels) noexcept
+{
+    // nobody is looking, so the meters cost nothing.
+    if (! isActive())
+        return;
+
+    const auto numSamples = buffer.getNumSamples();
+    numChannels = juce::jmin(numChannels, maxChannels);
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+    {
+        const auto* data = buffer.getReadPointer(channel);
+        auto peak = (SampleType) 0;
+        auto sumSquares = (SampleType) 0;
+
+        // one pass over data that is still in cache from the distortion.
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            peak = juce::jmax(peak, std::abs(data[i]));
+            sumSquares += data[i] * data[i];
+        }
+
+        _accumulating.peak[channel] = juce::jmax(_accumulating.peak[channel], (float) peak);
+        _accumulating.sumSquares[channel] += (double) sumSquares;
+    }
+
+    _accumulating.numChannels = numChannels;
+    _accumulating.numSamples += numSamples;
+
+    if (_accumulating.numSamples >= _samplesPerFrame)
+        publish();
+}
+
+template int LevelMeter::countClipped<float> (const float*, int, const float*, float) noexcept;
+template int LevelMeter::countClipped<double> (const double*, int, const float*, float) noexcept;
+template void LevelMeter::measureOutput<float> (const juce::AudioBuffer<float>&, int) noexcept;
+template void LevelMeter::measureOutput<double> (const juce::AudioBuffer<double>&, int) noexcept;
+
+void LevelMeter::publish() noexcept
+{
+    int start1, size1, start2, size2;
+    _fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    // the UI is behind; keep accumulating so nothing is lost and nothing waits.
+    if (size1 == 0)
+        return;
+
+    _frames[start1] = _accumulating;
+    _fifo.finishedWrite(1);
+    _accumulating = {};
+}
+
+bool LevelMeter::readLevels (Levels& levels) noexcept
+{
+    int start1, size1, start2, size2;
+    _fifo.prepareToRead(_fifo.getNumReady(), start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+        return false;
+
+    // combine every frame since the last read into one reading.
+    Frame total;
+    auto accumulate = [&total] (const Frame& frame)
+    {
+        total.numChannels = frame.numChannels;
+        total.numSamples += frame.numSamples;
+
+        for (auto channel = 0; channel < frame.numChannels; ++channel)
+        {
+            total.peak[channel] = juce::jmax(total.peak[channel], frame.peak[channel]);
+            total.sumSquares[channel] += frame.sumSquares[channel];
+            total.numClipped[channel] += frame.numClipped[channel];
+            total.numShaped[channel] += frame.numShaped[channel];
+        }
+    };
+
+    for (auto i = 0; i < size1; ++i)
+        accumulate(_frames[start1 + i]);
+    for (auto i = 0; i < size2; ++i)
+        accumulate(_frames[start2 + i]);
+
+    _fifo.finishedRead(size1 + size2);
+
+    levels.numChannels = total.numChannels;
+    for (auto channel = 0; channel < total.numChannels; ++channel)
+    {
+        auto& level = levels.channels[channel];
+        level.peak = total.peak[channel];
+        level.rms = total.numSamples > 0 ? (float) std::sqrt(total.sumSquares[channel] / total.numSamples) : 0.0f;
+        level.clipRatio = total.numShaped[channel] > 0 ? (float) total.numClipped[channel] / (float) total.numShaped[channel] : 0.0f;
+    }
+
+    return true;
+}
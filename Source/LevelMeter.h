@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    LevelMeter.h
+    Peak / RMS / clip-ratio metering handed from the audio thread to the UI.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class LevelMeter
+{
+public:
+    // v`l̏ (vOC̍ő`l)
+    static constexpr int maxChannels = 64;
+
+    // `lƂ̃x
+    struct ChannelLevel
+    {
+        float peak = 0.0f;       // s[N (jA)
+        float rms = 0.0f;        // RMS (jA)
+        float clipRatio = 0.0f;  // cݏŃNbvTv̊ (0`1)
+    };
+
+    // O̓ǂݏoȍ~̃x
+    struct Levels
+    {
+        int numChannels = 0;
+        ChannelLevel channels[maxChannels];
+    };
+
+    // ĐȌ (10msƂ1t[UI֓n)
+    void prepare(double sampleRate) noexcept;
+
+    // v̗L/ (GfB^\LɂALɂ鎞͌Ât[̂Ă)
+    void setEnabled(bool shouldBeEnabled) noexcept;
+
+    // v
+    bool isActive() const noexcept { return _enabled.load(std::memory_order_relaxed); }
+
+    // |data * gain| >= 1 (ramp  nullptr łȂ gain ̑ ramp[i]) ̃Tv
+    template <typename SampleType>
+    static int countClipped(const SampleType* data, int numSamples, const float* ramp, float gain) noexcept;
+
+    // cݏł̃Nbv̉Z (I[fBIXbhAnumSamples ͘cݏTv)
+    // I[o[TvO̓I[o[TvÕTvŐ
+    void addClipped(int channel, int numClipped, int numSamples) noexcept;
+
+    // s[NRMŠv (I[fBIXbhAo͂ɑ΂ČĂ)
+    template <typename SampleType>
+    void measureOutput(const juce::AudioBuffer<SampleType>& buffer, int numChannels) noexcept;
+
+    // x̓ǂݏo (UIXbhAVt[ꍇ false)
+    bool readLevels(Levels& levels) noexcept;
+
+private:
+    // UI֓nP (ubNWv)
+    struct Frame
+    {
+        int numChannels = 0;
+        int numSamples = 0;
+        float peak[maxChannels] = {};
+        double sumSquares[maxChannels] = {};
+        int numClipped[maxChannels] = {};
+        int numShaped[maxChannels] = {};    // Nbv𐔂Tv
+    };
+
+    // Wṽt[UI֓n (L[tȂWv𑱂)
+    void publish() noexcept;
+
+    static constexpr int fifoSize = 32;
+
+    juce::AbstractFifo _fifo { fifoSize };
+    Frame _frames[fifoSize];
+    Frame _accumulating;          // I[fBIXbĥ݂G
+    int _samplesPerFrame = 480;
+    std::atomic<bool> _enabled { false };
+};
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    LevelMeterComponent.cpp
+    Vertical peak / RMS bars for the editor.
+
+  ==============================================================================
+*/
+
+#include "LevelMeterComponent.h"
+
+namespace
+{
+    constexpr float minimumDecibels = -60.0f;
+    constexpr float maximumDecibels = 6.0f;
+
+    // per-update peak fall-off (~47 dB/s at the editor's 30 ms timer).
+    constexpr float peakDecay = 0.85f;
+
+    // changes smaller than this are below a pixel at the editor's meter size.
+    constexpr float repaintThreshold = 0.002f;
+}
+
+bool LevelMeterComponent::setLevels (const LevelMeter::Levels& levels)
+{
+    auto needsRepaint = levels.numChannels != _levels.numChannels;
+
+    for (auto channel = 0; channel < levels.numChannels; ++channel)
+    {
+        const auto& level = levels.channels[channel];
+
+        // the peak falls back slowly so short transients stay visible.
+        auto peak = juce::jmax(level.peak, _levels.channels[channel].peak * peakDecay);
+        _levels.channels[channel] = level;
+        _levels.channels[channel].peak = peak;
+
+        auto peakProportion = toProportion(peak);
+        auto rmsProportion = toProportion(level.rms);
+        auto clipped = level.clipRatio > 0.0f;
+
+        needsRepaint = needsRepaint
+                    || std::abs(peakProportion - _peakProportions[channel]) > repaintThreshold
+                    || std::abs(rmsProportion - _rmsProportions[channel]) > repaintThreshold
+                    || clipped != _clipped[channel];
+
+        _peakProportions[channel] = peakProportion;
+        _rmsProportions[channel] = rmsProportion;
+        _clipped[channel] = clipped;
+    }
+
+    _levels.numChannels = levels.numChannels;
+
+    if (needsRepaint)
+        repaint();
+
+    return needsRepaint;
+}
+
+bool LevelMeterComponent::decay()
+{
+    LevelMeter::Levels silence;
+    silence.numChannels = _levels.numChannels;
+    return setLevels(silence);
+}
+
+void LevelMeterComponent::paint (juce::Graphics& g)
+{
+    if (_levels.numChannels == 0)
+        return;
+
+    auto bounds = getLocalBounds().toFloat();
+    auto barWidth = bounds.getWidth() / (float) _levels.numChannels;
+
+    for (auto channel = 0; channel < _levels.numChannels; ++channel)
+    {
+        // keep a gap between bars, narrowing it when many channels share the width.
+        auto gap = juce::jmin(2.0f, barWidth * 0.15f);
+        auto bar = bounds.withX(bounds.getX() + barWidth * (float) channel).withWidth(barWidth).reduced(gap, 0.0f);
+
+        g.setColour(juce::Colours::black.withAlpha(0.5f));
+        g.fillRect(bar);
+
+        auto height = bar.getHeight();
+        g.setColour(_clipped[channel] ? juce::Colours::orangered : juce::Colours::lightgreen);
+        g.fillRect(bar.withTop(bar.getBottom() - height * _rmsProportions[channel]));
+
+        g.setColour(juce::Colours::white);
+        g.fillRect(bar.withTop(bar.getBottom() - height * _peakProportions[channel]).withHeight(2.0f));
+    }
+}
+
+float LevelMeterComponent::toProportion (float gain) noexcept
+{
+    auto decibels = juce::Decibels::gainToDecibels(gain, minimumDecibels);
+    return juce::jlimit(0.0f, 1.0f, (decibels - minimumDecibels) / (maximumDecibels - minimumDecibels));
+}
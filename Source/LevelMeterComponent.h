@@ -0,0 +1,34 @@
+/*
+  ==============================================================================
+
+    LevelMeterComponent.h
+    Vertical peak / RMS bars for the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LevelMeter.h"
+
+class LevelMeterComponent  : public juce::Component
+{
+public:
+    // Vx̔f (\ςꍇ̂ݍĕ`悵Atrue Ԃ)
+    bool setLevels(const LevelMeter::Levels& levels);
+
+    // Vx͂ȂԂ̌ (Đ~ȂǁAĕ`悵ꍇ true)
+    bool decay();
+
+    void paint(juce::Graphics& g) override;
+
+private:
+    // jAl[^[̍̊ɕϊ (-60dB`+6dB)
+    static float toProportion(float gain) noexcept;
+
+    LevelMeter::Levels _levels;
+    float _peakProportions[LevelMeter::maxChannels] = {};
+    float _rmsProportions[LevelMeter::maxChannels] = {};
+    bool _clipped[LevelMeter::maxChannels] = {};
+};
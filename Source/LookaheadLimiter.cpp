@@ -0,0 +1,195 @@
+/*
+  ==============================================================================
+
+    LookaheadLimiter.cpp
+    Soft-knee lookahead gain stage in front of the clipper.
+
+  ==============================================================================
+*/
+
+#include "LookaheadLimiter.h"
+
+namespace
+{
+// the gain recovers over this time once a peak has passed.
+constexpr double releaseMilliseconds = 50.0;
+
+// peaks below this level pass unchanged; above it the curve bends smoothly towards 1.0.
+constexpr float kneeStart = 0.5f;
+}
+
+void LookaheadLimiter::prepare (double sampleRate, int numChannels, int maximumBlockSize, bool doublePrecision)
+{
+    _sampleRate = sampleRate;
+    _capacity = juce::jmax(1, juce::roundToInt(maximumLookahead * sampleRate / 1000.0)) + 1;
+    _maximumBlockSize = maximumBlockSize;
+
+    // only the precision the host uses is kept, as in the bypass stage.
+    numChannels = juce::jmax(1, numChannels);
+    _delayLine.setSize(doublePrecision ? 0 : numChannels, doublePrecision ? 0 : _capacity);
+    _doubleDelayLine.setSize(doublePrecision ? numChannels : 0, doublePrecision ? _capacity : 0);
+
+    _dequeTimes.allocate((size_t) _capacity, true);
+    _dequePeaks.allocate((size_t) _capacity, true);
+    _averageWindow.allocate((size_t) _capacity, true);
+    _detector.allocate((size_t) maximumBlockSize, true);
+    _gains.allocate((size_t) maximumBlockSize, true);
+
+    _releaseCoefficient = (float) std::exp(-1000.0 / (releaseMilliseconds * sampleRate));
+
+    // the lookahead is kept as a time, so it survives sample rate changes.
+    _lookahead = getLatencySamples(_lookaheadMilliseconds);
+    reset();
+}
+
+void LookaheadLimiter::reset() noexcept
+{
+    _delayLine.clear();
+    _doubleDelayLine.clear();
+    _delayPosition = 0;
+
+    _dequeHead = 0;
+    _dequeSize = 0;
+    _time = 0;
+
+    auto window = _lookahead + 1;
+    if (_averageWindow.get() != nullptr)
+        std::fill(_averageWindow.get(), _averageWindow.get() + window, 1.0f);
+
+    _averageSum = (double) window;
+    _averagePosition = 0;
+    _releasedGain = 1.0f;
+    _lastPeak = 0.0f;
+    _lastGain = 1.0f;
+}
+
+void LookaheadLimiter::setLookahead (double milliseconds) noexcept
+{
+    _lookaheadMilliseconds = milliseconds;
+
+    auto lookahead = getLatencySamples(milliseconds);
+    if (lookahead == _lookahead)
+        return;
+
+    // the delayed signal and the window belong to the old length, so start over.
+    _lookahead = lookahead;
+    reset();
+}
+
+int LookaheadLimiter::getLatencySamples (double milliseconds) const noexcept
+{
+    milliseconds = juce::jlimit(minimumLookahead, maximumLookahead, milliseconds);
+    return juce::jlimit(1, juce::jmax(1, _capacity - 1), juce::roundToInt(milliseconds * _sampleRate / 1000.0));
+}
+
+float LookaheadLimiter::computeGain (float peak) noexcept
+{
+    if (peak <= kneeStart)
+        return 1.0f;
+
+    // tanh keeps the slope continuous at the knee and never reaches 1.0, so the clipper behind stays idle.
+    auto output = kneeStart + (1.0f - kneeStart) * std::tanh((peak - kneeStart) / (1.0f - kneeStart));
+    return output / peak;
+}
+
+void LookaheadLimiter::computeGains (int numSamples) noexcept
+{
+    // the window covers the delayed sample and everything up to the newest one.
+    auto window = _lookahead + 1;
+
+    for (auto i = 0; i < numSamples; ++i)
+    {
+        auto peak = _detector[i];
+
+        // sliding maximum: each peak enters and leaves the deque once, so the cost does not depend on the window.
+        if (_dequeSize > 0 && _time - _dequeTimes[_dequeHead] >= (juce::uint32) window)
+        {
+            _dequeHead = (_dequeHead + 1) % _capacity;
+            --_dequeSize;
+        }
+
+        while (_dequeSize > 0 && _dequePeaks[(_dequeHead + _dequeSize - 1) % _capacity] <= peak)
+            --_dequeSize;
+
+        auto back = (_dequeHead + _dequeSize) % _capacity;
+        _dequeTimes[back] = _time;
+        _dequePeaks[back] = peak;
+        ++_dequeSize;
+        ++_time;
+
+        // the maximum only changes now and then, so the curve is rarely evaluated.
+        auto windowPeak = _dequePeaks[_dequeHead];
+        if (windowPeak != _lastPeak)
+        {
+            _lastPeak = windowPeak;
+            _lastGain = computeGain(windowPeak);
+        }
+
+        // instant attack, exponential release.
+        _releasedGain = _lastGain < _releasedGain ? _lastGain
+                                                  : _lastGain + (_releasedGain - _lastGain) * _releaseCoefficient;
+
+        // averaging over the window turns the attack into a ramp that still reaches the held gain
+        // by the time the peak leaves the delay line.
+        _averageSum += _releasedGain - _averageWindow[_averagePosition];
+        _averageWindow[_averagePosition] = _releasedGain;
+
+        if (++_averagePosition == window)
+        {
+            // resum once per window, so rounding errors never build up.
+            _averagePosition = 0;
+            _averageSum = 0.0;
+            for (auto j = 0; j < window; ++j)
+                _averageSum += _averageWindow[j];
+        }
+
+        _gains[i] = (float) (_averageSum / window);
+    }
+}
+
+template <typename SampleType>
+void LookaheadLimiter::process (juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numChannels) noexcept
+{
+    auto& delayLine = getDelayLine(SampleType());
+    numChannels = juce::jmin(numChannels, delayLine.getNumChannels());
+
+    // the caller splits blocks to the prepared size, so this only guards against misuse.
+    if (numChannels == 0 || numSamples > _maximumBlockSize)
+    {
+        jassertfalse;
+        return;
+    }
+
+    // one detector for all channels, so a peak in one channel does not shift the image.
+    std::fill(_detector.get(), _detector.get() + numSamples, 0.0f);
+    for (auto channel = 0; channel < numChannels; ++channel)
+    {
+        auto* channelData = buffer.getReadPointer(channel, startSample);
+        for (auto i = 0; i < numSamples; ++i)
+            _detector[i] = juce::jmax(_detector[i], (float) std::abs(channelData[i]));
+    }
+
+    computeGains(numSamples);
+
+    // delay each channel by the lookahead and apply the shared gain.
+    for (auto channel = 0; channel < numChannels; ++channel)
+    {
+        auto* channelData = buffer.getWritePointer(channel, startSample);
+        auto* delayed = delayLine.getWritePointer(channel);
+
+        for (auto i = 0, position = _delayPosition; i < numSamples; ++i)
+        {
+            auto input = channelData[i];
+            channelData[i] = delayed[position] * (SampleType) _gains[i];
+            delayed[position] = input;
+
+            if (++position == _lookahead)
+                position = 0;
+        }
+    }
+
+    _delayPosition = (_delayPosition + numSamples) % _lookahead;
+}
+
+template void LookaheadLimiter::process<float> (juce::AudioBuffer<float>&, int, int, int) noexcept;
+template void LookaheadLimiter::process<double> (juce::AudioBuffer<double>&, int, int, int) noexcept;
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    LookaheadLimiter.h
+    Soft-knee lookahead gain stage in front of the clipper.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class LookaheadLimiter
+{
+public:
+    // ǂݎԂ͈̔(ms)
+    static constexpr double minimumLookahead = 0.5;
+    static constexpr double maximumLookahead = 5.0;
+
+    // ĐȌ (ő̐ǂݎԂŊmہAgp鐸x̑m)
+    void prepare(double sampleRate, int numChannels, int maximumBlockSize, bool doublePrecision);
+
+    // Ԃ̃NA
+    void reset() noexcept;
+
+    // ǂݎ(ms) (ωꍇ͏ԂNA)
+    void setLookahead(double milliseconds) noexcept;
+
+    // ݂̃CeV[(Tv) (= ǂ݂̃Tv)
+    int getLatencySamples() const noexcept { return _lookahead; }
+
+    // w肵ǂݎԂ̃CeV[(Tv)
+    int getLatencySamples(double milliseconds) const noexcept;
+
+    // S`lʂ̃QCŁAs[N 1.0 𒴂Ȃ悤ɗ} (numSamples  maximumBlockSize ȉ)
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numChannels) noexcept;
+
+private:
+    // s[Nɑ΂QC (\tgj[)
+    static float computeGain(float peak) noexcept;
+
+    // ubÑQC _gains ɌvZ (_detector ̃s[N)
+    void computeGains(int numSamples) noexcept;
+
+    // xƂ̒xobt@ (̓Tv^̑Ip)
+    juce::AudioBuffer<float>& getDelayLine(float) noexcept { return _delayLine; }
+    juce::AudioBuffer<double>& getDelayLine(double) noexcept { return _doubleDelayLine; }
+
+    double _sampleRate = 44100.0;
+    double _lookaheadMilliseconds = minimumLookahead;
+    int _lookahead = 1;             // ǂ݂̃Tv
+    int _capacity = 1;              // ̍ő咷 (ő̐ǂ + 1)
+    int _maximumBlockSize = 0;
+
+    // M̒xobt@ (gpȂx̑͋)
+    juce::AudioBuffer<float> _delayLine;
+    juce::AudioBuffer<double> _doubleDelayLine;
+    int _delayPosition = 0;
+
+    // ԍől (P̗[L[AOobt@)
+    juce::HeapBlock<juce::uint32> _dequeTimes;
+    juce::HeapBlock<float> _dequePeaks;
+    int _dequeHead = 0;
+    int _dequeSize = 0;
+    juce::uint32 _time = 0;
+
+    // QC̃[Xƈړ
+    juce::HeapBlock<float> _averageWindow;
+    double _averageSum = 0.0;
+    int _averagePosition = 0;
+    float _releasedGain = 1.0f;
+    float _releaseCoefficient = 0.0f;
+    float _lastPeak = 0.0f;
+    float _lastGain = 1.0f;
+
+    // ubNPʂ̍Ɨ̈
+    juce::HeapBlock<float> _detector;
+    juce::HeapBlock<float> _gains;
+};
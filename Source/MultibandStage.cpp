@@ -0,0 +1,343 @@
+/*
+  ==============================================================================
+
+    MultibandStage.cpp
+    Linkwitz-Riley band split with per-band clipping / waveshaping.
+
+  ==============================================================================
+*/
+
+#include "MultibandStage.h"
+#include "LevelMeter.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#elif JUCE_ARM && (defined (__ARM_NEON__) || defined (__ARM_NEON))
+ #include <arm_neon.h>
+ #define DISTORTION_USE_NEON 1
+#endif
+
+namespace
+{
+//==============================================================================
+// one lane per band; every lane runs the same instructions with its own coefficients.
+#if JUCE_INTEL
+using LaneVector = __m128;
+
+inline LaneVector loadLanes (const float* data) noexcept              { return _mm_loadu_ps(data); }
+inline void storeLanes (float* data, LaneVector v) noexcept           { _mm_storeu_ps(data, v); }
+inline LaneVector broadcast (float value) noexcept                    { return _mm_set1_ps(value); }
+inline LaneVector add (LaneVector a, LaneVector b) noexcept           { return _mm_add_ps(a, b); }
+inline LaneVector subtract (LaneVector a, LaneVector b) noexcept      { return _mm_sub_ps(a, b); }
+inline LaneVector multiply (LaneVector a, LaneVector b) noexcept      { return _mm_mul_ps(a, b); }
+inline LaneVector maximum (LaneVector a, LaneVector b) noexcept       { return _mm_max_ps(a, b); }
+inline LaneVector absolute (LaneVector v) noexcept                    { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+#elif DISTORTION_USE_NEON
+using LaneVector = float32x4_t;
+
+inline LaneVector loadLanes (const float* data) noexcept              { return vld1q_f32(data); }
+inline void storeLanes (float* data, LaneVector v) noexcept           { vst1q_f32(data, v); }
+inline LaneVector broadcast (float value) noexcept                    { return vdupq_n_f32(value); }
+inline LaneVector add (LaneVector a, LaneVector b) noexcept           { return vaddq_f32(a, b); }
+inline LaneVector subtract (LaneVector a, LaneVector b) noexcept      { return vsubq_f32(a, b); }
+inline LaneVector multiply (LaneVector a, LaneVector b) noexcept      { return vmulq_f32(a, b); }
+inline LaneVector maximum (LaneVector a, LaneVector b) noexcept       { return vmaxq_f32(a, b); }
+inline LaneVector absolute (LaneVector v) noexcept                    { return vabsq_f32(v); }
+#else
+struct LaneVector { float v[MultibandStage::maxBands]; };
+
+template <typename Function>
+inline LaneVector eachLane (LaneVector a, LaneVector b, Function&& function) noexcept
+{
+    for (auto lane = 0; lane < MultibandStage::maxBands; ++lane)
+        a.v[lane] = function(a.v[lane], b.v[lane]);
+    return a;
+}
+
+inline LaneVector loadLanes (const float* data) noexcept              { LaneVector v; std::copy(data, data + MultibandStage::maxBands, v.v); return v; }
+inline void storeLanes (float* data, LaneVector v) noexcept           { std::copy(v.v, v.v + MultibandStage::maxBands, data); }
+inline LaneVector broadcast (float value) noexcept                    { LaneVector v; std::fill(v.v, v.v + MultibandStage::maxBands, value); return v; }
+inline LaneVector add (LaneVector a, LaneVector b) noexcept           { return eachLane(a, b, [] (float x, float y) { return x + y; }); }
+inline LaneVector subtract (LaneVector a, LaneVector b) noexcept      { return eachLane(a, b, [] (float x, float y) { return x - y; }); }
+inline LaneVector multiply (LaneVector a, LaneVector b) noexcept      { return eachLane(a, b, [] (float x, float y) { return x * y; }); }
+inline LaneVector maximum (LaneVector a, LaneVector b) noexcept       { return eachLane(a, b, [] (float x, float y) { return std::max(x, y); }); }
+inline LaneVector absolute (LaneVector v) noexcept                    { return eachLane(v, v, [] (float x, float) { return std::abs(x); }); }
+#endif
+
+static_assert (MultibandStage::maxBands == 4, "one band per lane of a 4-wide vector");
+
+//==============================================================================
+// normalised biquad coefficients.
+struct Biquad
+{
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+};
+
+// Butterworth (Q = 1/sqrt(2)) sections; two in series make a 4th-order Linkwitz-Riley filter,
+// and the low- and high-pass of one crossover then sum to the all-pass below.
+struct CrossoverSections
+{
+    Biquad lowPass, highPass, allPass;
+
+    CrossoverSections (double frequency, double sampleRate) noexcept
+    {
+        auto w0 = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        auto cosw0 = std::cos(w0);
+        auto alpha = std::sin(w0) / juce::MathConstants<double>::sqrt2;
+        auto a0 = 1.0 + alpha;
+
+        auto denominator = [&] (Biquad& biquad)
+        {
+            biquad.a1 = -2.0 * cosw0 / a0;
+            biquad.a2 = (1.0 - alpha) / a0;
+        };
+
+        lowPass.b0 = lowPass.b2 = (1.0 - cosw0) / 2.0 / a0;
+        lowPass.b1 = (1.0 - cosw0) / a0;
+        denominator(lowPass);
+
+        highPass.b0 = highPass.b2 = (1.0 + cosw0) / 2.0 / a0;
+        highPass.b1 = -(1.0 + cosw0) / a0;
+        denominator(highPass);
+
+        allPass.b0 = (1.0 - alpha) / a0;
+        allPass.b1 = -2.0 * cosw0 / a0;
+        allPass.b2 = 1.0;
+        denominator(allPass);
+    }
+};
+}
+
+//==============================================================================
+void MultibandStage::prepare (double sampleRate, int numChannels, int maximumBlockSize, const Band* initialBands)
+{
+    _kernels = &DistortionKernels::getBestKernels();
+    _states.assign((size_t) juce::jmax(0, numChannels), ChannelState {});
+    _maximumBlockSize = maximumBlockSize;
+
+    for (auto band = 0; band < maxBands; ++band)
+    {
+        _bandData[band].allocate((size_t) maximumBlockSize, true);
+        _driveSmoothers[band].prepare(sampleRate, maximumBlockSize, initialBands[band].drive);
+        _special[band] = initialBands[band].special;
+        _driveRamps[band] = nullptr;
+    }
+
+    // force the coefficients to be rebuilt for the first block.
+    _processingRate = 0.0;
+}
+
+void MultibandStage::reset() noexcept
+{
+    std::fill(_states.begin(), _states.end(), ChannelState {});
+}
+
+void MultibandStage::setCrossovers (int numBands, const float* frequencies, double processingRate) noexcept
+{
+    numBands = juce::jlimit(1, maxBands, numBands);
+
+    // keep every crossover inside the audible range and well below Nyquist.
+    float limited[maxBands - 1] = {};
+    for (auto i = 0; i < numBands - 1; ++i)
+        limited[i] = juce::jlimit(20.0f, (float) (processingRate * 0.45), frequencies[i]);
+
+    auto rateChanged = processingRate != _processingRate;
+    auto changed = numBands != _numBands || rateChanged;
+    for (auto i = 0; i < numBands - 1; ++i)
+        changed = changed || limited[i] != _frequencies[i];
+
+    if (! changed)
+        return;
+
+    // the drives advance once per shaped sample, so their ramps are timed at the same rate.
+    if (rateChanged)
+    {
+        for (auto& smoother : _driveSmoothers)
+            smoother.setSampleRate(processingRate);
+    }
+
+    // a different band count routes the lanes differently, so their history no longer applies.
+    if (numBands != _numBands)
+        reset();
+
+    _numBands = numBands;
+    _processingRate = processingRate;
+    std::copy(limited, limited + (maxBands - 1), _frequencies);
+    updateCoefficients();
+}
+
+void MultibandStage::setBands (const Band* bands) noexcept
+{
+    for (auto band = 0; band < maxBands; ++band)
+    {
+        _special[band] = bands[band].special;
+        _driveSmoothers[band].setTargetValue(bands[band].drive);
+    }
+}
+
+void MultibandStage::advance (int numSamples) noexcept
+{
+    for (auto band = 0; band < maxBands; ++band)
+        _driveRamps[band] = _driveSmoothers[band].advance(numSamples);
+}
+
+int MultibandStage::process (int channel, float* data, int numSamples, bool countClipped) noexcept
+{
+    return processSamples(channel, data, numSamples, countClipped);
+}
+
+int MultibandStage::process (int channel, double* data, int numSamples, bool countClipped) noexcept
+{
+    return processSamples(channel, data, numSamples, countClipped);
+}
+
+void MultibandStage::updateCoefficients() noexcept
+{
+    _numStages = 2 * (_numBands - 1);
+
+    // band k: high-passed by the crossovers below it, low-passed by its own,
+    // and all-passed by those above it, so that the bands sum to an all-pass.
+    const Biquad identity;
+    for (auto crossover = 0; crossover < _numBands - 1; ++crossover)
+    {
+        CrossoverSections sections(_frequencies[crossover], _processingRate);
+
+        for (auto band = 0; band < maxBands; ++band)
+        {
+            const Biquad* first = &identity;
+            const Biquad* second = &identity;
+
+            // lanes above the band count stay pass-through and are never read.
+            if (band < _numBands)
+            {
+                if (crossover < band)
+                    first = second = &sections.highPass;
+                else if (crossover == band)
+                    first = second = &sections.lowPass;
+                else
+                    first = &sections.allPass;
+            }
+
+            auto set = [band] (StageCoefficients& stage, const Biquad& biquad)
+            {
+                stage.b0[band] = (float) biquad.b0;
+                stage.b1[band] = (float) biquad.b1;
+                stage.b2[band] = (float) biquad.b2;
+                stage.a1[band] = (float) biquad.a1;
+                stage.a2[band] = (float) biquad.a2;
+            };
+
+            set(_coefficients[2 * crossover], *first);
+            set(_coefficients[2 * crossover + 1], *second);
+        }
+    }
+}
+
+template <typename SampleType>
+int MultibandStage::processSamples (int channel, SampleType* data, int numSamples, bool countClipped) noexcept
+{
+    // the caller prepares one state per input channel and stays within the block size, so this only guards against misuse.
+    if (_numBands < 2 || ! juce::isPositiveAndBelow(channel, (int) _states.size()) || numSamples > _maximumBlockSize)
+    {
+        jassertfalse;
+        return 0;
+    }
+
+    auto& state = _states[(size_t) channel];
+
+    // split: every sample runs through all bands at once, one band per lane.
+    LaneVector b0[maxStages], b1[maxStages], b2[maxStages], a1[maxStages], a2[maxStages], z1[maxStages], z2[maxStages];
+    for (auto stage = 0; stage < _numStages; ++stage)
+    {
+        b0[stage] = loadLanes(_coefficients[stage].b0);
+        b1[stage] = loadLanes(_coefficients[stage].b1);
+        b2[stage] = loadLanes(_coefficients[stage].b2);
+        a1[stage] = loadLanes(_coefficients[stage].a1);
+        a2[stage] = loadLanes(_coefficients[stage].a2);
+        z1[stage] = loadLanes(state.z1[stage]);
+        z2[stage] = loadLanes(state.z2[stage]);
+    }
+
+    auto peak = broadcast(0.0f);
+    float lanes[maxBands];
+
+    for (auto i = 0; i < numSamples; ++i)
+    {
+        auto x = broadcast((float) data[i]);
+
+        // transposed direct form II.
+        for (auto stage = 0; stage < _numStages; ++stage)
+        {
+            auto y = add(multiply(b0[stage], x), z1[stage]);
+            z1[stage] = add(subtract(multiply(b1[stage], x), multiply(a1[stage], y)), z2[stage]);
+            z2[stage] = subtract(multiply(b2[stage], x), multiply(a2[stage], y));
+            x = y;
+        }
+
+        peak = maximum(peak, absolute(x));
+
+        storeLanes(lanes, x);
+        for (auto band = 0; band < _numBands; ++band)
+            _bandData[band][i] = lanes[band];
+    }
+
+    for (auto stage = 0; stage < _numStages; ++stage)
+    {
+        storeLanes(state.z1[stage], z1[stage]);
+        storeLanes(state.z2[stage], z2[stage]);
+    }
+
+    float peaks[maxBands];
+    storeLanes(peaks, peak);
+
+    // shape each band; one that never reaches the clipping point is linear, and at unity gain is left alone.
+    // the meter reports the band that clips the most, counted on the driven band signal.
+    auto mostClipped = 0;
+    for (auto band = 0; band < _numBands; ++band)
+    {
+        auto* bandData = _bandData[band].get();
+        auto* ramp = _driveRamps[band];
+        auto drive = _driveSmoothers[band].getTargetValue();
+        auto maximumDrive = ramp != nullptr ? juce::jmax(ramp[0], ramp[numSamples - 1]) : drive;
+        auto clipping = peaks[band] * maximumDrive > 1.0f;
+
+        if (! _special[band] && ! clipping)
+        {
+            if (ramp != nullptr || drive != 1.0f)
+                ParameterSmoother::applyGain(bandData, numSamples, ramp, drive);
+        }
+        else if (ramp != nullptr)
+        {
+            ParameterSmoother::applyGain(bandData, numSamples, ramp, drive);
+
+            if (countClipped && clipping)
+                mostClipped = juce::jmax(mostClipped, LevelMeter::countClipped(bandData, numSamples, nullptr, 1.0f));
+
+            if (_special[band])
+                _kernels->tanhShape(bandData, numSamples, 1.0f);
+            else
+                _kernels->hardClip(bandData, numSamples, 1.0f, 1.0f);
+        }
+        else
+        {
+            if (countClipped && clipping)
+                mostClipped = juce::jmax(mostClipped, LevelMeter::countClipped(bandData, numSamples, nullptr, drive));
+
+            // clamp(x, -1/drive, 1/drive) * drive == clamp(x * drive, -1, 1)
+            if (_special[band])
+                _kernels->tanhShape(bandData, numSamples, drive);
+            else
+                _kernels->hardClip(bandData, numSamples, 1.0f / drive, drive);
+        }
+    }
+
+    // sum the bands back into the channel.
+    auto* sum = _bandData[0].get();
+    for (auto band = 1; band < _numBands; ++band)
+        juce::FloatVectorOperations::add(sum, _bandData[band].get(), numSamples);
+
+    for (auto i = 0; i < numSamples; ++i)
+        data[i] = (SampleType) sum[i];
+
+    return mostClipped;
+}
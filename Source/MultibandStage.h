@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    MultibandStage.h
+    Linkwitz-Riley band split with per-band clipping / waveshaping.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DistortionKernels.h"
+#include "ParameterSmoother.h"
+
+class MultibandStage
+{
+public:
+    // ш搔̏ (tB^͑шSIMD̃[Ɋ蓖ĂĈxɏ)
+    static constexpr int maxBands = 4;
+
+    // ш悲Ƃ̘cݐݒ
+    struct Band
+    {
+        bool special = false;   // tanh (false ̓n[hNbv)
+        float drive = 1.0f;     // ͔{ (n[hNbv 1 / thresholdAtanh ͓͔{)
+    };
+
+    // ĐȌ (maximumBlockSize ̓I[o[TvO̍őTv)
+    void prepare(double sampleRate, int numChannels, int maximumBlockSize, const Band* initialBands);
+
+    // tB^̏Ԃ̃NA
+    void reset() noexcept;
+
+    // ш搔ƃNXI[o[g (AnumBands - 1 )AprocessingRate ͏Tv[g
+    // ωꍇ̂݌WČvZ (processingRate ςꍇ drive ̃v킹)
+    void setCrossovers(int numBands, const float* frequencies, double processingRate) noexcept;
+
+    // ш悲Ƃ̘cݐݒ (drive ̓X[WO)
+    void setBands(const Band* bands) noexcept;
+
+    // drive ̃vubNi߂ (S`lʁAprocess ̑OɈxĂ)
+    void advance(int numSamples) noexcept;
+
+    // ш敪Aш悲Ƃ̘c݁A (numSamples  advance Ɠ)
+    // countClipped  true ̏ꍇAłNbvш̃NbvԂ (false Ȃ 0)
+    int process(int channel, float* data, int numSamples, bool countClipped) noexcept;
+    int process(int channel, double* data, int numSamples, bool countClipped) noexcept;
+
+private:
+    // ȉ (NXI[o[1ɂ2i)
+    static constexpr int maxStages = 2 * (maxBands - 1);
+
+    // 1[1ш̑o2tB^1ǐW
+    struct StageCoefficients
+    {
+        float b0[maxBands], b1[maxBands], b2[maxBands], a1[maxBands], a2[maxBands];
+    };
+
+    // 1[1ш̃tB^ (`l)
+    struct ChannelState
+    {
+        float z1[maxStages][maxBands];
+        float z2[maxStages][maxBands];
+    };
+
+    template <typename SampleType>
+    int processSamples(int channel, SampleType* data, int numSamples, bool countClipped) noexcept;
+
+    void updateCoefficients() noexcept;
+
+    const DistortionKernels::KernelSet* _kernels = nullptr;
+
+    StageCoefficients _coefficients[maxStages];
+    std::vector<ChannelState> _states;
+    int _numBands = 1;
+    int _numStages = 0;
+    float _frequencies[maxBands - 1] = {};
+    double _processingRate = 0.0;
+
+    // ш悲Ƃ̐MƘcݐݒ
+    juce::HeapBlock<float> _bandData[maxBands];
+    ParameterSmoother _driveSmoothers[maxBands];
+    const float* _driveRamps[maxBands] = {};
+    bool _special[maxBands] = {};
+    int _maximumBlockSize = 0;
+};
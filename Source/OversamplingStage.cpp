@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    OversamplingStage.cpp
+    Oversampling around the clipping nonlinearity.
+
+  ==============================================================================
+*/
+
+#include "OversamplingStage.h"
+
+namespace
+{
+// build every combination up front, so switching never allocates on the audio thread.
+template <typename SampleType, typename Set>
+void buildOversamplers (Set& oversamplers, int numChannels, int maximumBlockSize)
+{
+    for (auto filterType = 0; filterType < OversamplingStage::TotalFilterTypeNum; ++filterType)
+    {
+        auto type = filterType == OversamplingStage::PolyphaseIIR ? juce::dsp::Oversampling<SampleType>::filterHalfBandPolyphaseIIR
+                                                                  : juce::dsp::Oversampling<SampleType>::filterHalfBandFIREquiripple;
+
+        for (int factor = OversamplingStage::Factor2x; factor < OversamplingStage::TotalFactorNum; ++factor)
+        {
+            auto oversampler = std::make_unique<juce::dsp::Oversampling<SampleType>>((size_t) juce::jmax(1, numChannels), (size_t) factor, type, true, true);
+            oversampler->initProcessing((size_t) maximumBlockSize);
+            oversamplers[filterType][factor] = std::move(oversampler);
+        }
+    }
+}
+
+template <typename Set>
+void releaseOversamplers (Set& oversamplers)
+{
+    for (auto& row : oversamplers)
+        for (auto& oversampler : row)
+            oversampler.reset();
+}
+}
+
+void OversamplingStage::prepare (int numChannels, int maximumBlockSize, bool doublePrecision)
+{
+    // only the precision the host uses is kept, so a 64-bit host does not pay for both.
+    if (doublePrecision)
+    {
+        releaseOversamplers(_oversamplers);
+        buildOversamplers<double>(_doubleOversamplers, numChannels, maximumBlockSize);
+    }
+    else
+    {
+        releaseOversamplers(_doubleOversamplers);
+        buildOversamplers<float>(_oversamplers, numChannels, maximumBlockSize);
+    }
+
+    _current = _oversamplers[_filterType][_factor].get();
+    _currentDouble = _doubleOversamplers[_filterType][_factor].get();
+}
+
+void OversamplingStage::reset() noexcept
+{
+    for (auto& oversamplers : _oversamplers)
+        for (auto& oversampler : oversamplers)
+            if (oversampler != nullptr)
+                oversampler->reset();
+
+    for (auto& oversamplers : _doubleOversamplers)
+        for (auto& oversampler : oversamplers)
+            if (oversampler != nullptr)
+                oversampler->reset();
+}
+
+bool OversamplingStage::select (int factor, int filterType) noexcept
+{
+    factor = juce::jlimit((int) Factor1x, TotalFactorNum - 1, factor);
+    filterType = juce::jlimit((int) PolyphaseIIR, TotalFilterTypeNum - 1, filterType);
+
+    if (factor == _factor && filterType == _filterType)
+        return false;
+
+    _factor = factor;
+    _filterType = filterType;
+    _current = _oversamplers[_filterType][_factor].get();
+    _currentDouble = _doubleOversamplers[_filterType][_factor].get();
+
+    // the newly selected filters may hold state from the last time they were used.
+    if (_current != nullptr)
+        _current->reset();
+    if (_currentDouble != nullptr)
+        _currentDouble->reset();
+
+    return true;
+}
+
+int OversamplingStage::getLatencySamples() const noexcept
+{
+    if (_currentDouble != nullptr)
+        return juce::roundToInt(_currentDouble->getLatencyInSamples());
+
+    return _current != nullptr ? juce::roundToInt(_current->getLatencyInSamples()) : 0;
+}
+
+int OversamplingStage::getLatencySamples (int factor, int filterType) const noexcept
+{
+    return juce::roundToInt(getLatency(factor, filterType));
+}
+
+double OversamplingStage::getLatency (int factor, int filterType) const noexcept
+{
+    factor = juce::jlimit((int) Factor1x, TotalFactorNum - 1, factor);
+    filterType = juce::jlimit((int) PolyphaseIIR, TotalFilterTypeNum - 1, filterType);
+
+    if (auto* oversampler = _doubleOversamplers[filterType][factor].get())
+        return (double) oversampler->getLatencyInSamples();
+
+    auto* oversampler = _oversamplers[filterType][factor].get();
+    return oversampler != nullptr ? (double) oversampler->getLatencyInSamples() : 0.0;
+}
+
+juce::dsp::AudioBlock<float> OversamplingStage::processUp (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    jassert(_current != nullptr);
+    return _current->processSamplesUp(block);
+}
+
+void OversamplingStage::processDown (juce::dsp::AudioBlock<float>& block) noexcept
+{
+    jassert(_current != nullptr);
+    _current->processSamplesDown(block);
+}
+
+juce::dsp::AudioBlock<double> OversamplingStage::processUp (const juce::dsp::AudioBlock<double>& block) noexcept
+{
+    jassert(_currentDouble != nullptr);
+    return _currentDouble->processSamplesUp(block);
+}
+
+void OversamplingStage::processDown (juce::dsp::AudioBlock<double>& block) noexcept
+{
+    jassert(_currentDouble != nullptr);
+    _currentDouble->processSamplesDown(block);
+}
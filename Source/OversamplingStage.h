@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    OversamplingStage.h
+    Oversampling around the clipping nonlinearity.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class OversamplingStage
+{
+public:
+    // I[o[TvO{
+    enum Factor
+    {
+        Factor1x = 0,
+        Factor2x,
+        Factor4x,
+        Factor8x,
+        TotalFactorNum,
+    };
+
+    // tB^̎
+    enum FilterType
+    {
+        PolyphaseIIR = 0,  // ჌CeV[
+        LinearPhaseFIR,    // ʑ
+        TotalFilterTypeNum,
+    };
+
+    // ĐȌ (gp鐸xŁASĂ̔{EtB^̑gݍ킹m)
+    void prepare(int numChannels, int maximumBlockSize, bool doublePrecision = false);
+
+    // Ԃ̃NA
+    void reset() noexcept;
+
+    // gp{ƃtB^̑I (ύXꍇ true)
+    bool select(int factor, int filterType) noexcept;
+
+    // I[o[TvOL (1x ̏ꍇ false)
+    bool isActive() const noexcept { return _current != nullptr || _currentDouble != nullptr; }
+
+    // ݂̃CeV[(Tv)
+    int getLatencySamples() const noexcept;
+
+    // w肵{ƃtB^̃CeV[(Tv)
+    int getLatencySamples(int factor, int filterType) const noexcept;
+
+    // w肵{ƃtB^̃CeV[(ۂ߂Ȍ̃Tv)
+    double getLatency(int factor, int filterType) const noexcept;
+
+    // AbvTvO (I[o[TvOꂽubNԂ)
+    juce::dsp::AudioBlock<float> processUp(const juce::dsp::AudioBlock<float>& block) noexcept;
+    juce::dsp::AudioBlock<double> processUp(const juce::dsp::AudioBlock<double>& block) noexcept;
+
+    // _ETvO (ʂ block ɏ߂)
+    void processDown(juce::dsp::AudioBlock<float>& block) noexcept;
+    void processDown(juce::dsp::AudioBlock<double>& block) noexcept;
+
+private:
+    // {EtB^̑Sgݍ킹 (gpȂx̑͋)
+    template <typename SampleType>
+    using OversamplerSet = std::unique_ptr<juce::dsp::Oversampling<SampleType>>[TotalFilterTypeNum][TotalFactorNum];
+
+    OversamplerSet<float> _oversamplers;
+    OversamplerSet<double> _doubleOversamplers;
+    juce::dsp::Oversampling<float>* _current = nullptr;
+    juce::dsp::Oversampling<double>* _currentDouble = nullptr;
+    int _factor = Factor1x;
+    int _filterType = PolyphaseIIR;
+};
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    ParameterSmoother.cpp
+    Per-sample parameter ramps for zipper-free automation.
+
+  ==============================================================================
+*/
+
+#include "ParameterSmoother.h"
+
+void ParameterSmoother::setRampLength (double milliseconds) noexcept
+{
+    _rampLengthMilliseconds = juce::jmax(0.0, milliseconds);
+}
+
+void ParameterSmoother::prepare (double sampleRate, int maximumBlockSize, float initialValue)
+{
+    _value.reset(sampleRate, _rampLengthMilliseconds * 0.001);
+    _value.setCurrentAndTargetValue(initialValue);
+
+    _ramp.allocate((size_t) maximumBlockSize, true);
+    _maximumBlockSize = maximumBlockSize;
+}
+
+void ParameterSmoother::setSampleRate (double sampleRate) noexcept
+{
+    // reset() jumps to the target, so put back where the ramp was and let it carry on.
+    auto current = _value.getCurrentValue();
+    auto target = _value.getTargetValue();
+
+    _value.reset(sampleRate, _rampLengthMilliseconds * 0.001);
+    _value.setCurrentAndTargetValue(current);
+    _value.setTargetValue(target);
+}
+
+void ParameterSmoother::setTargetValue (float newValue) noexcept
+{
+    _value.setTargetValue(newValue);
+}
+
+void ParameterSmoother::setCurrentAndTargetValue (float newValue) noexcept
+{
+    _value.setCurrentAndTargetValue(newValue);
+}
+
+const float* ParameterSmoother::advance (int numSamples) noexcept
+{
+    // steady state: nothing to do.
+    if (! _value.isSmoothing())
+        return nullptr;
+
+    // the caller splits blocks to the prepared size, so this only guards against misuse.
+    if (numSamples > _maximumBlockSize)
+    {
+        jassertfalse;
+        _value.setCurrentAndTargetValue(_value.getTargetValue());
+        return nullptr;
+    }
+
+    for (auto i = 0; i < numSamples; ++i)
+        _ramp[i] = _value.getNextValue();
+
+    return _ramp.get();
+}
+
+void ParameterSmoother::applyGain (float* data, int numSamples, const float* ramp, float gain) noexcept
+{
+    if (ramp != nullptr)
+        juce::FloatVectorOperations::multiply(data, ramp, numSamples);
+    else if (gain != 1.0f)
+        juce::FloatVectorOperations::multiply(data, gain, numSamples);
+}
+
+void ParameterSmoother::applyGain (double* data, int numSamples, const float* ramp, float gain) noexcept
+{
+    // ramps stay float; widening them per sample is cheaper than keeping double copies.
+    if (ramp != nullptr)
+    {
+        for (auto i = 0; i < numSamples; ++i)
+            data[i] *= (double) ramp[i];
+    }
+    else if (gain != 1.0f)
+    {
+        juce::FloatVectorOperations::multiply(data, (double) gain, numSamples);
+    }
+}
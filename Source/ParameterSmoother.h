@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    ParameterSmoother.h
+    Per-sample parameter ramps for zipper-free automation.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class ParameterSmoother
+{
+public:
+    // v(ms)̐ݒ ( prepare L)
+    void setRampLength(double milliseconds) noexcept;
+
+    // ĐȌ (vpobt@̊m)
+    void prepare(double sampleRate, int maximumBlockSize, float initialValue);
+
+    // li߂Tv[g̕ύX (mۂsȂAω̃v͌ݒlV[gő)
+    void setSampleRate(double sampleRate) noexcept;
+
+    // ڕWl̍XV
+    void setTargetValue(float newValue) noexcept;
+
+    // ڕWl֑Ɉړ
+    void setCurrentAndTargetValue(float newValue) noexcept;
+
+    // ڕWl
+    float getTargetValue() const noexcept { return _value.getTargetValue(); }
+
+    // ubNli߂
+    // ὠTvƂ̒lԂAԂł nullptr Ԃ
+    const float* advance(int numSamples) noexcept;
+
+    // data ɃQC| (ramp  nullptr ̏ꍇ͒萔 gain)
+    static void applyGain(float* data, int numSamples, const float* ramp, float gain) noexcept;
+    static void applyGain(double* data, int numSamples, const float* ramp, float gain) noexcept;
+
+private:
+    juce::SmoothedValue<float> _value;
+    juce::HeapBlock<float> _ramp;
+    int _maximumBlockSize = 0;
+    double _rampLengthMilliseconds = 20.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterSmoother)
+};
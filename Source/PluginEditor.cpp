@@ -9,10 +9,27 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace
+{
+    // timer interval while something on screen is changing, and after it settles.
+    constexpr int activeTimerInterval = 30;
+    constexpr int idleTimerInterval = 250;
+    constexpr int ticksBeforeIdle = 1000 / activeTimerInterval;
+
+    // the load statistics are a moving summary; refreshing them faster is just noise.
+    constexpr juce::uint32 dspLoadUpdateInterval = 500;
+}
+
 //==============================================================================
 Juce_plugin_distortionAudioProcessorEditor::Juce_plugin_distortionAudioProcessorEditor (Juce_plugin_distortionAudioProcessor& p, juce::AudioProcessorValueTreeState& vts)
     : AudioProcessorEditor (&p), audioProcessor (p), valueTreeState (vts)
 {
+    // decode the background once; paint only blits the cached layer.
+    _backgroundImage = juce::ImageCache::getFromMemory(BinaryData::bg_plugin_distortion_png, BinaryData::bg_plugin_distortion_pngSize);
+    std::fill(std::begin(_displayedValues), std::end(_displayedValues), -1.0f);
+
+    // the background covers every pixel, so nothing behind the editor needs repainting.
+    setOpaque(true);
     setSize (420, 300);
 
     // init ui components.
@@ -23,6 +40,14 @@ Juce_plugin_distortionAudioProcessorEditor::Juce_plugin_distortionAudioProcessor
     initLabelComponent(&_gainLabel, processor.getParameterText(Juce_plugin_distortionAudioProcessor::Gain));
     initLabelComponent(&_outputVolumeLabel, processor.getParameterText(Juce_plugin_distortionAudioProcessor::OutputVolume));
     initToggleButtonComponent(&_specialToggle, processor.getParameterText(Juce_plugin_distortionAudioProcessor::Special));
+    initComboBoxComponent(&_oversamplingComboBox, { "1x", "2x", "4x", "8x" });
+    initComboBoxComponent(&_oversamplingFilterComboBox, { "IIR", "FIR" });
+    initComboBoxComponent(&_antiAliasingComboBox, { "Off", "ADAA1", "ADAA2" });
+    initLabelComponent(&_dspLoadLabel, {});
+    _dspLoadLabel.setFont(juce::Font(12.0f, juce::Font::plain));
+    _dspLoadLabel.setJustificationType(juce::Justification::centredLeft);
+    initLabelComponent(&_clipLabel, {});
+    _clipLabel.setFont(juce::Font(12.0f, juce::Font::plain));
 
     // linking ui components and parameters.
     _inputVolumeSliderAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(
@@ -41,6 +66,18 @@ Juce_plugin_distortionAudioProcessorEditor::Juce_plugin_distortionAudioProcessor
         valueTreeState,
         audioProcessor.getParameterID(Juce_plugin_distortionAudioProcessor::Parameters::Special),
         _specialToggle));
+    _oversamplingComboBoxAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(
+        valueTreeState,
+        audioProcessor.getParameterID(Juce_plugin_distortionAudioProcessor::Parameters::Oversampling),
+        _oversamplingComboBox));
+    _oversamplingFilterComboBoxAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(
+        valueTreeState,
+        audioProcessor.getParameterID(Juce_plugin_distortionAudioProcessor::Parameters::OversamplingFilter),
+        _oversamplingFilterComboBox));
+    _antiAliasingComboBoxAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(
+        valueTreeState,
+        audioProcessor.getParameterID(Juce_plugin_distortionAudioProcessor::Parameters::AntiAliasing),
+        _antiAliasingComboBox));
 
     // display window.
     addAndMakeVisible(&_inputVolumeSlider);
@@ -50,24 +87,56 @@ Juce_plugin_distortionAudioProcessorEditor::Juce_plugin_distortionAudioProcessor
     addAndMakeVisible(&_gainLabel);
     addAndMakeVisible(&_outputVolumeLabel);
     addAndMakeVisible(&_specialToggle);
+    addAndMakeVisible(&_oversamplingComboBox);
+    addAndMakeVisible(&_oversamplingFilterComboBox);
+    addAndMakeVisible(&_antiAliasingComboBox);
+    addAndMakeVisible(&_levelMeterComponent);
+    addAndMakeVisible(&_clipLabel);
+
+    // the meters only measure while someone is looking at them.
+    audioProcessor.getLevelMeter().setEnabled(true);
+    if (DspLoadMeter::isCompiledIn())
+    {
+        addAndMakeVisible(&_dspLoadLabel);
+        audioProcessor.getDspLoadMeter().setEnabled(true);
+    }
 
-    // start timer monitoring.
-    startTimer(30);
+    // show the current values, then follow changes as the processor reports them.
+    refreshParameter(Juce_plugin_distortionAudioProcessor::InputVolume);
+    refreshParameter(Juce_plugin_distortionAudioProcessor::Gain);
+    refreshParameter(Juce_plugin_distortionAudioProcessor::OutputVolume);
+    refreshParameter(Juce_plugin_distortionAudioProcessor::Special);
+    audioProcessor.fetchDirtyParameters();
+
+   #if JUCE_MAJOR_VERSION < 7
+    _frameTimer.onFrame = [this] { syncDirtyParameters(); };
+    _frameTimer.startTimerHz(60);
+   #endif
+
+    // start timer monitoring (meters only; parameters arrive through syncDirtyParameters).
+    startTimer(activeTimerInterval);
 }
 
 Juce_plugin_distortionAudioProcessorEditor::~Juce_plugin_distortionAudioProcessorEditor()
 {
+    audioProcessor.getDspLoadMeter().setEnabled(false);
+    audioProcessor.getLevelMeter().setEnabled(false);
 }
 
 //==============================================================================
 void Juce_plugin_distortionAudioProcessorEditor::paint (juce::Graphics& g)
 {
-    auto backgroundImage = juce::ImageCache::getFromMemory(BinaryData::bg_plugin_distortion_png, BinaryData::bg_plugin_distortion_pngSize);
-    g.drawImageAt(backgroundImage, 0, 0);
+    g.drawImageAt(_backgroundLayer, 0, 0);
 }
 
 void Juce_plugin_distortionAudioProcessorEditor::resized()
 {
+    // scale the background here rather than in paint, so each repaint is a plain copy.
+    if (_backgroundImage.getBounds() == getLocalBounds())
+        _backgroundLayer = _backgroundImage;
+    else
+        _backgroundLayer = _backgroundImage.rescaled(getWidth(), getHeight(), juce::Graphics::highResamplingQuality);
+
     auto contentHeight = 160;
     auto contentPosY = 48;
     auto labelHight = 60;
@@ -87,6 +156,18 @@ void Juce_plugin_distortionAudioProcessorEditor::resized()
         .setBounds(348, labelPosY, 60, labelHight);
     _specialToggle
         .setBounds(12, 8, 140, 30);
+    _antiAliasingComboBox
+        .setBounds(160, 12, 84, 22);
+    _oversamplingComboBox
+        .setBounds(252, 12, 76, 22);
+    _oversamplingFilterComboBox
+        .setBounds(336, 12, 72, 22);
+    _levelMeterComponent
+        .setBounds(236, contentPosY + 8, 48, contentHeight - 16);
+    _clipLabel
+        .setBounds(220, labelPosY, 80, 20);
+    _dspLoadLabel
+        .setBounds(12, 276, 396, 20);
 }
 
 void Juce_plugin_distortionAudioProcessorEditor::initSliderComponent(juce::Slider* slider, juce::Slider::SliderStyle style)
@@ -114,21 +195,117 @@ void Juce_plugin_distortionAudioProcessorEditor::initToggleButtonComponent(juce:
     (*toggleButton).setColour(juce::ToggleButton::textColourId, juce::Colours::white);
 }
 
+void Juce_plugin_distortionAudioProcessorEditor::initComboBoxComponent(juce::ComboBox* comboBox, const juce::StringArray& items)
+{
+    // item ids start from 1, so that the attachment can map them to choice indices.
+    (*comboBox).addItemList(items, 1);
+    (*comboBox).setColour(juce::ComboBox::backgroundColourId, juce::Colours::darkgrey);
+    (*comboBox).setColour(juce::ComboBox::textColourId, juce::Colours::white);
+    (*comboBox).setColour(juce::ComboBox::outlineColourId, juce::Colours::lightgrey);
+}
+
 void Juce_plugin_distortionAudioProcessorEditor::timerCallback()
 {
-    _inputVolumeSlider
-        .setValue(processor.getParameter(Juce_plugin_distortionAudioProcessor::InputVolume), juce::dontSendNotification);
-    _gainSlider
-        .setValue(processor.getParameter(Juce_plugin_distortionAudioProcessor::Gain), juce::dontSendNotification);
-    _outputVolumeSlider
-        .setValue(processor.getParameter(Juce_plugin_distortionAudioProcessor::OutputVolume), juce::dontSendNotification);
-    _specialToggle
-        .setToggleState(processor.getParameter(Juce_plugin_distortionAudioProcessor::Special) == 1.0f, juce::dontSendNotification);
+    auto changed = updateLevelMeters();
 
-    _inputVolumeLabel
-        .setText(processor.getParameterText(Juce_plugin_distortionAudioProcessor::InputVolume), juce::dontSendNotification);
-    _gainLabel
-        .setText(processor.getParameterText(Juce_plugin_distortionAudioProcessor::Gain), juce::dontSendNotification);
-    _outputVolumeLabel
-        .setText(processor.getParameterText(Juce_plugin_distortionAudioProcessor::OutputVolume), juce::dontSendNotification);
+    if (DspLoadMeter::isCompiledIn())
+        updateDspLoadLabel();
+
+    // poll slowly while nothing moves, and return to full rate on the first change.
+    _idleTicks = changed ? 0 : _idleTicks + 1;
+    auto interval = _idleTicks > ticksBeforeIdle ? idleTimerInterval : activeTimerInterval;
+    if (getTimerInterval() != interval)
+        startTimer(interval);
+}
+
+void Juce_plugin_distortionAudioProcessorEditor::syncDirtyParameters()
+{
+    // one atomic exchange per frame while nothing moves; any burst of changes between frames becomes a single update.
+    auto dirty = audioProcessor.fetchDirtyParameters();
+
+    for (auto index = 0; dirty != 0; ++index, dirty >>= 1)
+        if ((dirty & 1u) != 0)
+            refreshParameter(index);
+}
+
+bool Juce_plugin_distortionAudioProcessorEditor::refreshParameter(int index)
+{
+    auto value = processor.getParameter(index);
+    if (value == _displayedValues[index])
+        return false;
+
+    _displayedValues[index] = value;
+
+    // format the label text only for the value that changed.
+    switch (index)
+    {
+    case Juce_plugin_distortionAudioProcessor::InputVolume:
+        _inputVolumeSlider.setValue(value, juce::dontSendNotification);
+        _inputVolumeLabel.setText(processor.getParameterText(index), juce::dontSendNotification);
+        break;
+    case Juce_plugin_distortionAudioProcessor::Gain:
+        _gainSlider.setValue(value, juce::dontSendNotification);
+        _gainLabel.setText(processor.getParameterText(index), juce::dontSendNotification);
+        break;
+    case Juce_plugin_distortionAudioProcessor::OutputVolume:
+        _outputVolumeSlider.setValue(value, juce::dontSendNotification);
+        _outputVolumeLabel.setText(processor.getParameterText(index), juce::dontSendNotification);
+        break;
+    case Juce_plugin_distortionAudioProcessor::Special:
+        _specialToggle.setToggleState(value == 1.0f, juce::dontSendNotification);
+        break;
+    default:
+        break;
+    }
+
+    return true;
+}
+
+void Juce_plugin_distortionAudioProcessorEditor::updateDspLoadLabel()
+{
+    auto now = juce::Time::getMillisecondCounter();
+    if (now - _lastDspLoadUpdate < dspLoadUpdateInterval)
+        return;
+
+    _lastDspLoadUpdate = now;
+
+    auto statistics = audioProcessor.getDspLoadMeter().getStatistics();
+    if (statistics.numBlocks == 0)
+        return;
+
+    auto percent = [] (float load) { return juce::String(load * 100.0f, 1) + "%"; };
+
+    _dspLoadLabel.setText("DSP  min " + percent(statistics.minimum)
+                          + "  avg " + percent(statistics.average)
+                          + "  p99 " + percent(statistics.percentile99)
+                          + "  max " + percent(statistics.maximum),
+                          juce::dontSendNotification);
+}
+
+bool Juce_plugin_distortionAudioProcessorEditor::updateLevelMeters()
+{
+    // everything the audio thread published since the last tick arrives as one reading.
+    LevelMeter::Levels levels;
+    if (! audioProcessor.getLevelMeter().readLevels(levels))
+        return _levelMeterComponent.decay();
+
+    auto changed = _levelMeterComponent.setLevels(levels);
+
+    auto clipRatio = 0.0f;
+    for (auto channel = 0; channel < levels.numChannels; ++channel)
+        clipRatio = juce::jmax(clipRatio, levels.channels[channel].clipRatio);
+
+    // the label shows tenths of a percent, so only rebuild it when those change.
+    auto clipPermille = juce::roundToInt(clipRatio * 1000.0f);
+    if (clipRatio > 0.0f)
+        clipPermille = juce::jmax(1, clipPermille);
+
+    if (clipPermille != _displayedClipPermille)
+    {
+        _displayedClipPermille = clipPermille;
+        _clipLabel.setText(clipPermille > 0 ? "Clip " + juce::String(clipPermille / 10.0f, 1) + "%" : juce::String(), juce::dontSendNotification);
+        changed = true;
+    }
+
+    return changed;
 }
@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "LevelMeterComponent.h"
 
 class Juce_plugin_distortionAudioProcessorEditor  : public juce::AudioProcessorEditor,
     private juce::Timer
@@ -33,19 +34,66 @@ private:
     juce::Label _gainLabel;
     juce::Label _outputVolumeLabel;
     juce::ToggleButton _specialToggle;
+    juce::ComboBox _oversamplingComboBox;
+    juce::ComboBox _oversamplingFilterComboBox;
+    juce::ComboBox _antiAliasingComboBox;
+    juce::Label _dspLoadLabel;
+    LevelMeterComponent _levelMeterComponent;
+    juce::Label _clipLabel;
 
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> _inputVolumeSliderAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> _gainSliderAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> _outputVolumeSliderAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> _specialToggleAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> _oversamplingComboBoxAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> _oversamplingFilterComboBoxAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> _antiAliasingComboBoxAttachment;
 
     // UIR|[lg
     void initSliderComponent(juce::Slider* slider, juce::Slider::SliderStyle style);
     void initLabelComponent(juce::Label* label, juce::String text);
     void initToggleButtonComponent(juce::ToggleButton* toggleButton, juce::String text);
+    void initComboBoxComponent(juce::ComboBox* comboBox, const juce::StringArray& items);
 
     // ^C}[ɂύXĎFProcessor->Editor
     void timerCallback() override;
 
+    // p[^̕\XV (lςꍇ̂݁Aω true)
+    bool refreshParameter(int index);
+
+    // ωp[^\ɔf (1t[1)
+    void syncDirtyParameters();
+
+    // DSPׂ̕\XV
+    void updateDspLoadLabel();
+
+    // x[^[̕\XV (ĕ`悵ꍇ true)
+    bool updateLevelMeters();
+
+    // wi摜 (resized ŕ\TCYɍ킹Ĉxgk)
+    juce::Image _backgroundImage;
+    juce::Image _backgroundLayer;
+
+    // \̃p[^l (ω̌op)
+    float _displayedValues[Juce_plugin_distortionAudioProcessor::TotalParameterNum];
+    int _displayedClipPermille = 0;
+
+    // ω̖^C}[Ăяỏ (萔𒴂ƃ^C}[x)
+    int _idleTicks = 0;
+    juce::uint32 _lastDspLoadUpdate = 0;
+
+    // ʂ̍XV^C~Oł̃p[^f
+   #if JUCE_MAJOR_VERSION >= 7
+    juce::VBlankAttachment _vBlankAttachment { this, [this] { syncDirtyParameters(); } };
+   #else
+    // VBlankAttachment o[Wł 60Hz ̃^C}[őp
+    struct FrameTimer  : public juce::Timer
+    {
+        std::function<void()> onFrame;
+        void timerCallback() override { onFrame(); }
+    };
+    FrameTimer _frameTimer;
+   #endif
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Juce_plugin_distortionAudioProcessorEditor)
 };
@@ -7,7 +7,38 @@
 */
 
 #include "PluginProcessor.h"
-#include "PluginEditor.h"
+#if ! DISTORTION_HEADLESS
+ #include "PluginEditor.h"
+#endif
+
+namespace
+{
+// factory programs; parameters not listed keep their defaults.
+const char* const factoryPresets = R"(
+Init:
+Clean Boost:    In=1.2  Gain=1.0   Out=1.0
+Crunch:         Gain=1.25 Out=0.95
+Drive:          Gain=1.5  Out=0.9
+Heavy:          Gain=1.8  Out=0.8
+Special Boost:  Gain=1.3  Special=1 Out=0.9
+Special Fuzz:   In=1.1  Gain=2.0  Special=1 Out=0.7
+)";
+
+// filters, ramps and the bypass crossfade fall below the silence threshold within this time.
+constexpr double settleSeconds = 0.2;
+
+// the smoothers' ramps over one span as a core state: straight from their first to their last sample.
+DistortionCore::State makeCoreState (int numSamples, const float* preGainRamp, float preGain, const float* outputRamp, float outputGain) noexcept
+{
+    DistortionCore::State state;
+    state.preGain          = preGainRamp != nullptr ? preGainRamp[0] : preGain;
+    state.targetPreGain    = preGainRamp != nullptr ? preGainRamp[numSamples - 1] : preGain;
+    state.outputGain       = outputRamp != nullptr ? outputRamp[0] : outputGain;
+    state.targetOutputGain = outputRamp != nullptr ? outputRamp[numSamples - 1] : outputGain;
+    state.rampLength       = preGainRamp != nullptr || outputRamp != nullptr ? numSamples - 1 : 0;
+    return state;
+}
+}
 
 //==============================================================================
 Juce_plugin_distortionAudioProcessor::Juce_plugin_distortionAudioProcessor() : 
@@ -26,11 +57,46 @@ Juce_plugin_distortionAudioProcessor::Juce_plugin_distortionAudioProcessor() :
             // define parameters.
             // * volume slider: 0.0 ~ 1.5 => -100dB ~  7dB
             // * gain slider:   1.0 ~ 2.0 =>    0dB ~ 12dB
-            std::make_unique<juce::AudioParameterFloat>(getParameterID(MasterBypass), getParameterName(MasterBypass), 0.0f, 1.0f, 0.0f),
+            // * crossover:     20Hz ~ 20kHz (skewed towards the low end)
+            // * lookahead:     0.5ms ~ 5ms (reported as latency while the limiter is on)
+            // * tilt:          -12dB ~ 12dB (difference between the low and high end)
+            // * low/high cut:  the lowest low cut and the highest high cut switch the filter off
+            std::make_unique<juce::AudioParameterBool>(getParameterID(MasterBypass), getParameterName(MasterBypass), false),
             std::make_unique<juce::AudioParameterFloat>(getParameterID(InputVolume),  getParameterName(InputVolume),  0.0f, 1.5f, 1.0f),
             std::make_unique<juce::AudioParameterFloat>(getParameterID(Gain),         getParameterName(Gain),         1.0f, 2.0f, 1.0f),
             std::make_unique<juce::AudioParameterFloat>(getParameterID(OutputVolume), getParameterName(OutputVolume), 0.0f, 1.5f, 1.0f),
             std::make_unique<juce::AudioParameterFloat>(getParameterID(Special),      getParameterName(Special),      0.0f, 1.0f, 0.0f),
+            std::make_unique<juce::AudioParameterChoice>(getParameterID(Oversampling),       getParameterName(Oversampling),       juce::StringArray { "1x", "2x", "4x", "8x" }, OversamplingStage::Factor1x),
+            std::make_unique<juce::AudioParameterChoice>(getParameterID(OversamplingFilter), getParameterName(OversamplingFilter), juce::StringArray { "IIR", "FIR" }, OversamplingStage::PolyphaseIIR),
+            std::make_unique<juce::AudioParameterChoice>(getParameterID(AntiAliasing),       getParameterName(AntiAliasing),       juce::StringArray { "Off", "ADAA1", "ADAA2" }, AntiderivativeShaper::Off),
+            std::make_unique<juce::AudioParameterChoice>(getParameterID(Bands),              getParameterName(Bands),              juce::StringArray { "1", "2", "3", "4" }, 0),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(Crossover1), getParameterName(Crossover1), juce::NormalisableRange<float>(20.0f, 20000.0f, 0.0f, 0.25f), 200.0f),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(Crossover2), getParameterName(Crossover2), juce::NormalisableRange<float>(20.0f, 20000.0f, 0.0f, 0.25f), 1000.0f),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(Crossover3), getParameterName(Crossover3), juce::NormalisableRange<float>(20.0f, 20000.0f, 0.0f, 0.25f), 5000.0f),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(BandGain1),  getParameterName(BandGain1),  1.0f, 2.0f, 1.0f),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(BandGain2),  getParameterName(BandGain2),  1.0f, 2.0f, 1.0f),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(BandGain3),  getParameterName(BandGain3),  1.0f, 2.0f, 1.0f),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(BandGain4),  getParameterName(BandGain4),  1.0f, 2.0f, 1.0f),
+            std::make_unique<juce::AudioParameterBool>(getParameterID(BandSpecial1), getParameterName(BandSpecial1), false),
+            std::make_unique<juce::AudioParameterBool>(getParameterID(BandSpecial2), getParameterName(BandSpecial2), false),
+            std::make_unique<juce::AudioParameterBool>(getParameterID(BandSpecial3), getParameterName(BandSpecial3), false),
+            std::make_unique<juce::AudioParameterBool>(getParameterID(BandSpecial4), getParameterName(BandSpecial4), false),
+            std::make_unique<juce::AudioParameterBool>(getParameterID(Limiter),    getParameterName(Limiter),    false),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(Lookahead), getParameterName(Lookahead),
+                                                        juce::NormalisableRange<float>((float) LookaheadLimiter::minimumLookahead, (float) LookaheadLimiter::maximumLookahead, 0.1f), 1.5f),
+            std::make_unique<juce::AudioParameterBool>(getParameterID(Cabinet),    getParameterName(Cabinet),    false),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(PreTilt),     getParameterName(PreTilt),
+                                                        juce::NormalisableRange<float>(-ToneFilterStage::maximumTilt, ToneFilterStage::maximumTilt, 0.1f), 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(PreLowCut),   getParameterName(PreLowCut),
+                                                        juce::NormalisableRange<float>(ToneFilterStage::lowCutOff, ToneFilterStage::lowCutMaximum, 0.0f, 0.3f), ToneFilterStage::lowCutOff),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(PreHighCut),  getParameterName(PreHighCut),
+                                                        juce::NormalisableRange<float>(ToneFilterStage::highCutMinimum, ToneFilterStage::highCutOff, 0.0f, 0.3f), ToneFilterStage::highCutOff),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(PostTilt),    getParameterName(PostTilt),
+                                                        juce::NormalisableRange<float>(-ToneFilterStage::maximumTilt, ToneFilterStage::maximumTilt, 0.1f), 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(PostLowCut),  getParameterName(PostLowCut),
+                                                        juce::NormalisableRange<float>(ToneFilterStage::lowCutOff, ToneFilterStage::lowCutMaximum, 0.0f, 0.3f), ToneFilterStage::lowCutOff),
+            std::make_unique<juce::AudioParameterFloat>(getParameterID(PostHighCut), getParameterName(PostHighCut),
+                                                        juce::NormalisableRange<float>(ToneFilterStage::highCutMinimum, ToneFilterStage::highCutOff, 0.0f, 0.3f), ToneFilterStage::highCutOff),
         })
 { 
     // set default values.
@@ -39,10 +105,74 @@ Juce_plugin_distortionAudioProcessor::Juce_plugin_distortionAudioProcessor() :
     _gainParameter         = _parameters.getRawParameterValue(getParameterID(Gain));
     _outputVolumeParameter = _parameters.getRawParameterValue(getParameterID(OutputVolume));
     _specialParameter      = _parameters.getRawParameterValue(getParameterID(Special));
+    _oversamplingParameter       = _parameters.getRawParameterValue(getParameterID(Oversampling));
+    _oversamplingFilterParameter = _parameters.getRawParameterValue(getParameterID(OversamplingFilter));
+    _antiAliasingParameter       = _parameters.getRawParameterValue(getParameterID(AntiAliasing));
+    _bandsParameter              = _parameters.getRawParameterValue(getParameterID(Bands));
+    _limiterParameter            = _parameters.getRawParameterValue(getParameterID(Limiter));
+    _lookaheadParameter          = _parameters.getRawParameterValue(getParameterID(Lookahead));
+    _cabinetParameter            = _parameters.getRawParameterValue(getParameterID(Cabinet));
+    _preTiltParameter            = _parameters.getRawParameterValue(getParameterID(PreTilt));
+    _preLowCutParameter          = _parameters.getRawParameterValue(getParameterID(PreLowCut));
+    _preHighCutParameter         = _parameters.getRawParameterValue(getParameterID(PreHighCut));
+    _postTiltParameter           = _parameters.getRawParameterValue(getParameterID(PostTilt));
+    _postLowCutParameter         = _parameters.getRawParameterValue(getParameterID(PostLowCut));
+    _postHighCutParameter        = _parameters.getRawParameterValue(getParameterID(PostHighCut));
+
+    for (auto i = 0; i < MultibandStage::maxBands - 1; ++i)
+        _crossoverParameters[i] = _parameters.getRawParameterValue(getParameterID(Crossover1 + i));
+
+    for (auto band = 0; band < MultibandStage::maxBands; ++band)
+    {
+        _bandGainParameters[band]    = _parameters.getRawParameterValue(getParameterID(BandGain1 + band));
+        _bandSpecialParameters[band] = _parameters.getRawParameterValue(getParameterID(BandSpecial1 + band));
+    }
+
+    for (auto index = 0; index < TotalParameterNum; ++index)
+    {
+        _parameterObjects[index] = _parameters.getParameter(getParameterID(index));
+        _rawParameterValues[index] = _parameters.getRawParameterValue(getParameterID(index));
+    }
+
+    // parse the factory programs and the user's preset file once, so switching only reads the table.
+    juce::StringArray parameterNames;
+    ParameterValues defaultValues;
+    for (auto index = 0; index < TotalParameterNum; ++index)
+    {
+        parameterNames.add(getParameterName(index));
+        defaultValues[(size_t) index] = _parameterObjects[index]->convertFrom0to1(_parameterObjects[index]->getDefaultValue());
+    }
+
+    _presetBank.setParameters(parameterNames, defaultValues.data());
+    _presetBank.parse(factoryPresets);
+    _presetBank.loadFile(getUserPresetFile());
+
+    // the cabinet impulse response is read in the background once playback is prepared.
+    _convolution.loadImpulseResponse(getImpulseResponseFile());
+
+    // default MIDI CC assignments: CC 20 + parameter index for the controllable parameters.
+    std::fill(std::begin(_midiControllerParameters), std::end(_midiControllerParameters), -1);
+    for (auto index = 0; index < TotalParameterNum; ++index)
+        if (isMidiControllable(index))
+            _midiControllerParameters[20 + index] = index;
+
+    // select dsp kernels for this cpu.
+    _kernels = &DistortionKernels::getBestKernels();
+
+    // listen to every parameter, so the editor learns about changes without polling.
+    for (auto index = 0; index < TotalParameterNum; ++index)
+        _parameters.addParameterListener(getParameterID(index), this);
+
+    // MIDI changes reach the host from the message thread.
+    startTimerHz(30);
 }
 
 Juce_plugin_distortionAudioProcessor::~Juce_plugin_distortionAudioProcessor()
 {
+    stopTimer();
+    for (auto index = 0; index < TotalParameterNum; ++index)
+        _parameters.removeParameterListener(getParameterID(index), this);
+    _waveshaperTable.release();
 }
 
 //==============================================================================
@@ -80,44 +210,247 @@ bool Juce_plugin_distortionAudioProcessor::isMidiEffect() const
 
 double Juce_plugin_distortionAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // hosts that suspend silent tracks stop calling processBlock once this has passed.
+    return (takeParameterSnapshot().cabinet ? ConvolutionStage::maximumLength : 0.0) + settleSeconds;
 }
 
 int Juce_plugin_distortionAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return juce::jmax(1, _presetBank.getNumPresets());   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                                                         // so this should be at least 1, even if you're not really implementing programs.
 }
 
 int Juce_plugin_distortionAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return _currentProgram.load();
 }
 
 void Juce_plugin_distortionAudioProcessor::setCurrentProgram (int index)
 {
+    auto* values = _presetBank.getValues(index);
+    if (values == nullptr)
+        return;
+
+    // the parameters change one by one below; while the sequence is odd (or moved), the audio thread
+    // takes the whole program from the table instead, so no block mixes the old and the new program.
+    _programSwitchIndex.store(index);
+    _programSwitchSequence.fetch_add(1);
+
+    for (auto i = 0; i < TotalParameterNum; ++i)
+        if (isProgramParameter(i))
+            _parameterObjects[i]->setValueNotifyingHost(_parameterObjects[i]->convertTo0to1(values[i]));
+
+    _programSwitchSequence.fetch_add(1);
+    _currentProgram.store(index);
 }
 
 const juce::String Juce_plugin_distortionAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return _presetBank.getName(index);
 }
 
 void Juce_plugin_distortionAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    _presetBank.setName(index, newName);
+}
+
+bool Juce_plugin_distortionAudioProcessor::isProgramParameter (int index) noexcept
+{
+    // quality settings and bypass stay as they are, so switching never clicks or changes the latency.
+    return isMidiControllable(index);
+}
+
+juce::File Juce_plugin_distortionAudioProcessor::getUserPresetFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile(JucePlugin_Name).getChildFile("Presets.txt");
+}
+
+juce::File Juce_plugin_distortionAudioProcessor::getImpulseResponseFile()
+{
+    auto directory = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile(JucePlugin_Name);
+    return directory.getChildFile("Cabinet.aiff").existsAsFile() ? directory.getChildFile("Cabinet.aiff")
+                                                                 : directory.getChildFile("Cabinet.wav");
+}
+
+void Juce_plugin_distortionAudioProcessor::loadImpulseResponse (const juce::File& file)
+{
+    _convolution.loadImpulseResponse(file);
+}
+
+bool Juce_plugin_distortionAudioProcessor::isImpulseResponseReady() const noexcept
+{
+    return _convolution.isReady();
+}
+
+void Juce_plugin_distortionAudioProcessor::overlayProgram (int program, ParameterValues& values) const noexcept
+{
+    auto* presetValues = _presetBank.getValues(program);
+    if (presetValues == nullptr)
+        return;
+
+    for (auto index = 0; index < TotalParameterNum; ++index)
+        if (isProgramParameter(index))
+            values[(size_t) index] = presetValues[index];
 }
 
 //==============================================================================
 void Juce_plugin_distortionAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
+    // prepare parameter smoothing from the current values, so playback starts without a ramp.
+    auto params = takeParameterSnapshot();
+    _inputGainSmoother.prepare(sampleRate, samplesPerBlock, params.inputGain);
+    _clipDriveSmoother.prepare(sampleRate, samplesPerBlock, params.inverseThreshold);
+    _specialDriveSmoother.prepare(sampleRate, samplesPerBlock, params.specialDrive);
+    _outputGainSmoother.prepare(sampleRate, samplesPerBlock, params.outputGain);
+
+    _preGainRamp.allocate((size_t) samplesPerBlock, true);
+    _maximumBlockSize = samplesPerBlock;
+
+    // prepare oversampling and report its latency.
+    _oversampling.prepare(getTotalNumInputChannels(), samplesPerBlock, isUsingDoublePrecision());
+    _oversampling.select(params.oversamplingFactor, params.oversamplingFilter);
+    _oversampling.reset();
+
+    // prepare the lookahead limiter, sized for the longest lookahead.
+    _limiter.prepare(sampleRate, getTotalNumInputChannels(), samplesPerBlock, isUsingDoublePrecision());
+    _limiter.setLookahead(params.lookahead);
+    _limiterActive = params.limiter;
+    setLatencySamples(getEffectLatencySamples(params));
+
+    // prepare the bypass crossfade, with room to delay the dry signal by the largest latency.
+    auto maximumLatency = 0;
+    for (auto factor = 0; factor < OversamplingStage::TotalFactorNum; ++factor)
+        for (auto filterType = 0; filterType < OversamplingStage::TotalFilterTypeNum; ++filterType)
+            maximumLatency = juce::jmax(maximumLatency, _oversampling.getLatencySamples(factor, filterType));
+    maximumLatency += juce::roundToInt(std::ceil(AntiderivativeShaper::getDelaySamples(AntiderivativeShaper::TotalOrderNum - 1)));
+    maximumLatency += _limiter.getLatencySamples(LookaheadLimiter::maximumLookahead);
+
+    _bypass.prepare(sampleRate, getTotalNumInputChannels(), samplesPerBlock, maximumLatency, isUsingDoublePrecision());
+    _bypass.setDelay(getEffectLatencySamples(params));
+    _bypass.reset(params.bypass);
+
+    // prepare antiderivative anti-aliasing.
+    _antiderivativeShaper.prepare(getTotalNumInputChannels());
+
+    // prepare the tone filters; their coefficients are built for this rate on the first block.
+    _preTone.prepare(sampleRate, getTotalNumInputChannels());
+    _postTone.prepare(sampleRate, getTotalNumInputChannels());
+
+    // prepare the cabinet convolution; its impulse response is ready for the first block.
+    _convolution.prepare(sampleRate, getTotalNumInputChannels(), samplesPerBlock, ! isNonRealtime());
+    _cabinetActive = params.cabinet;
+
+    // prepare the band split for the largest oversampled block.
+    _multiband.prepare(sampleRate, getTotalNumInputChannels(), samplesPerBlock << (OversamplingStage::TotalFactorNum - 1), params.bands);
+
+    // prepare the waveshaper table for the current Gain.
+    _waveshaperTable.prepare(params.specialDrive);
+
+    // count silence from scratch, since nothing has been processed yet.
+    _silenceDetector.reset();
+
+    // restart the load statistics for the new block deadline.
+    _dspLoadMeter.prepare(sampleRate);
+    _levelMeter.prepare(sampleRate);
+}
+
+void Juce_plugin_distortionAudioProcessor::setParameterRampLength (int index, double milliseconds)
+{
+    switch (index)
+    {
+    case InputVolume:
+        _inputGainSmoother.setRampLength(milliseconds);
+        break;
+    case Gain:
+        _clipDriveSmoother.setRampLength(milliseconds);
+        _specialDriveSmoother.setRampLength(milliseconds);
+        break;
+    case OutputVolume:
+        _outputGainSmoother.setRampLength(milliseconds);
+        break;
+    default:
+        break;
+    }
+}
+
+void Juce_plugin_distortionAudioProcessor::setBypassCrossfadeLength (double milliseconds)
+{
+    _bypass.setCrossfadeLength(milliseconds);
+}
+
+void Juce_plugin_distortionAudioProcessor::setWaveshaperTableOptions (int tableSize, WaveshaperTable::Interpolation interpolation)
+{
+    _waveshaperTable.setOptions(tableSize, interpolation);
+}
+
+size_t Juce_plugin_distortionAudioProcessor::getWaveshaperTableMemoryFootprint() const noexcept
+{
+    return _waveshaperTable.getMemoryFootprint();
+}
+
+void Juce_plugin_distortionAudioProcessor::parameterChanged (const juce::String& parameterID, float newValue)
+{
+    // the new value is already stored, so the snapshot derives the matching values.
+    juce::ignoreUnused(newValue);
+    auto index = parameterID.getIntValue();
+
+    // may run on the audio thread (host automation), so only flag it for the editor.
+    _dirtyParameters.fetch_or(1u << index);
+
+    if (index == Gain)
+    {
+        _waveshaperTable.requestDrive(takeParameterSnapshot().specialDrive);
+    }
+    else if (index == Oversampling || index == OversamplingFilter || index == AntiAliasing || index == Bands || index == Limiter || index == Lookahead)
+    {
+        // host automation may call this on the audio thread, and notifying the host takes locks; the timer reports it.
+        _latencyChanged.store(true);
+    }
+}
+
+int Juce_plugin_distortionAudioProcessor::getEffectLatencySamples (const ParameterSnapshot& params) const noexcept
+{
+    // ADAA delays by half a sample per order at the rate it runs at, which the bands do not use;
+    // the oversampling filters' delay is fractional as well, so the two are rounded together.
+    auto shapingLatency = _oversampling.getLatency(params.oversamplingFactor, params.oversamplingFilter);
+    if (params.numBands <= 1)
+        shapingLatency += AntiderivativeShaper::getDelaySamples(params.antiAliasing) / (double) (1 << params.oversamplingFactor);
+
+    auto latency = juce::roundToInt(shapingLatency);
+    if (params.limiter)
+        latency += _limiter.getLatencySamples(params.lookahead);
+
+    return latency;
+}
+
+int Juce_plugin_distortionAudioProcessor::getTailSamples (const ParameterSnapshot& params) const noexcept
+{
+    auto seconds = (params.cabinet ? ConvolutionStage::maximumLength : 0.0) + settleSeconds;
+    return getEffectLatencySamples(params) + juce::roundToInt(seconds * getSampleRate());
+}
+
+juce::uint32 Juce_plugin_distortionAudioProcessor::fetchDirtyParameters() noexcept
+{
+    return _dirtyParameters.exchange(0);
 }
 
 void Juce_plugin_distortionAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    _waveshaperTable.release();
+    _convolution.release();
+}
+
+bool Juce_plugin_distortionAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+juce::AudioProcessorParameter* Juce_plugin_distortionAudioProcessor::getBypassParameter() const
+{
+    return _parameterObjects[MasterBypass];
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -127,8 +460,9 @@ bool Juce_plugin_distortionAudioProcessor::isBusesLayoutSupported (const BusesLa
     juce::ignoreUnused (layouts);
     return true;
   #else
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // any layout (surround, ambisonics, discrete) up to maxNumChannels.
+    auto mainOutputSize = layouts.getMainOutputChannelSet().size();
+    if (mainOutputSize < 1 || mainOutputSize > maxNumChannels)
         return false;
 
    #if ! JucePlugin_IsSynth
@@ -143,6 +477,37 @@ bool Juce_plugin_distortionAudioProcessor::isBusesLayoutSupported (const BusesLa
 
 void Juce_plugin_distortionAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    processSamples(buffer, midiMessages, false);
+}
+
+void Juce_plugin_distortionAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer, midiMessages, false);
+}
+
+// hosts that bypass without the bypass parameter still get the crossfade and the delayed dry signal.
+void Juce_plugin_distortionAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer, midiMessages, true);
+}
+
+void Juce_plugin_distortionAudioProcessor::processBlockBypassed (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer, midiMessages, true);
+}
+
+template <typename SampleType>
+void Juce_plugin_distortionAudioProcessor::processSamples (juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midiMessages, bool hostBypassed)
+{
+    // no heap or locks from here on (checked when DISTORTION_REALTIME_CHECKS is enabled).
+    const RealtimeSafetyChecker::ScopedRealtimeSection realtimeSection;
+
+    // flush denormals to zero in every stage, so decaying state never slows the block down.
+    const juce::ScopedNoDenormals noDenormals;
+
+    // time the whole block against its deadline (only while the editor shows it).
+    const DspLoadMeter::ScopedMeasurement loadMeasurement(_dspLoadMeter, buffer.getNumSamples());
+
     // get IN/OUT chennels.
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -151,65 +516,583 @@ void Juce_plugin_distortionAudioProcessor::processBlock (juce::AudioBuffer<float
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    // check bypass.
-    if (getParameter(MasterBypass) == 1.0f)
+    // take parameter values for this block, and the MIDI CC changes inside it.
+    auto numSamples = buffer.getNumSamples();
+    auto values = readParameterValues();
+    auto numEvents = collectParameterEvents(midiMessages, numSamples);
+
+    // a program change takes effect at the start of the block it arrives in, every parameter at once.
+    if (_midiProgram >= 0)
+    {
+        overlayProgram(_midiProgram, values);
+        _currentProgram.store(_midiProgram);
+        _midiProgram = -1;
+        _programChanged.store(true);
+    }
+
+    // the block's final values go to the parameters now; the host hears about them from the message thread.
+    publishParameterEvents();
+
+    auto params = makeParameterSnapshot(values);
+
+    // check bypass; the dry signal is delayed by the latency the host compensates for.
+    _bypass.setDelay(getEffectLatencySamples(params));
+    auto wasFullyBypassed = _bypass.isFullyBypassed();
+    _bypass.setBypassed(params.bypass || hostBypassed);
+
+    if (_bypass.isFullyBypassed())
+    {
+        // nothing else runs: no ramps, no oversampling and no metering.
+        _bypass.processBypassed(buffer, totalNumInputChannels);
+        return;
+    }
+
+    if (wasFullyBypassed)
+    {
+        // skip the ramps and drop the filter history, so that the fade-in does not start from stale state.
+        _inputGainSmoother.setCurrentAndTargetValue(params.inputGain);
+        _clipDriveSmoother.setCurrentAndTargetValue(params.inverseThreshold);
+        _specialDriveSmoother.setCurrentAndTargetValue(params.specialDrive);
+        _outputGainSmoother.setCurrentAndTargetValue(params.outputGain);
+        _oversampling.reset();
+        _multiband.reset();
+        _limiter.reset();
+        _preTone.reset();
+        _postTone.reset();
+        _convolution.reset();
+        _antiAliasingOrder = AntiderivativeShaper::Off;
+    }
+
+    // an idle track only costs the peak scan once everything inside has decayed;
+    // the stages pick up where they stopped, holding nothing but silence.
+    // a bypass crossfade only advances while the block is processed, so it is never settled.
+    auto silent = _silenceDetector.process(buffer, totalNumInputChannels, getTailSamples(params));
+    if (silent && ! _bypass.isFading())
     {
+        for (auto channel = 0; channel < totalNumInputChannels; ++channel)
+            buffer.clear(channel, 0, numSamples);
         return;
     }
 
-    // apply input volume.
-    buffer.applyGain(pow(getParameter(InputVolume), 2));
+    // switch oversampling (its latency is reported from parameterChanged).
+    auto oversamplingChanged = _oversampling.select(params.oversamplingFactor, params.oversamplingFilter);
 
-    // gain to threshold.
-    auto gainDecibel = juce::Decibels::gainToDecibels(pow(getParameter(Gain), 2));
-    auto threshold = juce::Decibels::decibelsToGain(gainDecibel * -1.0);
+    // the band filters' history belongs to the previous rate.
+    if (oversamplingChanged)
+        _multiband.reset();
 
-    // apply distortion.
-    for (auto channel = 0; channel < totalNumInputChannels; ++channel)
+    // a new lookahead restarts the limiter, and so does switching it on: its delay line was not fed meanwhile.
+    _limiter.setLookahead(params.lookahead);
+    if (params.limiter && ! _limiterActive)
+        _limiter.reset();
+    _limiterActive = params.limiter;
+
+    // the cabinet's history stopped while it was off, so it starts over rather than replaying it.
+    if (params.cabinet && ! _cabinetActive)
+        _convolution.reset();
+    _cabinetActive = params.cabinet;
+
+    // restart the ADAA history when it was idle or ran at another rate.
+    if (oversamplingChanged || _antiAliasingOrder == AntiderivativeShaper::Off)
+        _antiderivativeShaper.reset();
+    _antiAliasingOrder = params.antiAliasing;
+
+    // split the block where parameters change, but never into pieces shorter than the minimum;
+    // an event closer than that to the current segment start takes effect at that start.
+    auto segmentStart = 0;
+    for (auto i = 0; i < numEvents; ++i)
     {
-        auto* channelData = buffer.getWritePointer (channel);
-        for (auto buffNum = 0; buffNum < buffer.getNumSamples(); buffNum++)
+        const auto& event = _parameterEvents[i];
+
+        if (event.samplePosition - segmentStart >= _minimumSubBlockSize)
         {
-            // special effect.
-            if (getParameter(Special) == 1.0f)
-            {
-                channelData[buffNum] *= (gainDecibel/2.0);
-                channelData[buffNum] = tanh(5.0 * channelData[buffNum] / 2);
-                continue;
-            }
+            processSegment(buffer, segmentStart, event.samplePosition - segmentStart, params);
+            segmentStart = event.samplePosition;
+        }
 
-            // clipping by threshold.
-            if (channelData[buffNum] >= threshold)
-            {
-                channelData[buffNum] = threshold;
-            }
-            else if (channelData[buffNum] <= -threshold)
+        values[(size_t) event.index] = event.value;
+        params = makeParameterSnapshot(values);
+    }
+
+    processSegment(buffer, segmentStart, numSamples - segmentStart, params);
+
+    _levelMeter.measureOutput(buffer, totalNumInputChannels);
+}
+
+template <typename SampleType>
+void Juce_plugin_distortionAudioProcessor::processSegment (juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, const ParameterSnapshot& params)
+{
+    // update smoothing targets, so each change ramps from its own position.
+    _inputGainSmoother.setTargetValue(params.inputGain);
+    _clipDriveSmoother.setTargetValue(params.inverseThreshold);
+    _specialDriveSmoother.setTargetValue(params.specialDrive);
+    _outputGainSmoother.setTargetValue(params.outputGain);
+
+    // coefficients are only rebuilt for the filters whose setting changed.
+    _preTone.setSettings(params.preTone);
+    _postTone.setSettings(params.postTone);
+
+    // process in chunks no larger than the prepared block size,
+    // keeping the dry input of each chunk for the bypass crossfade.
+    auto totalNumInputChannels = getTotalNumInputChannels();
+    auto chunkSize = _maximumBlockSize > 0 ? _maximumBlockSize : numSamples;
+    for (auto offset = 0; offset < numSamples; offset += chunkSize)
+    {
+        auto chunkStart = startSample + offset;
+        auto chunkLength = juce::jmin(chunkSize, numSamples - offset);
+
+        _bypass.pushDry(buffer, chunkStart, chunkLength, totalNumInputChannels);
+
+        // the tone filters sit around the whole distortion, at the host rate.
+        _preTone.process(buffer, chunkStart, chunkLength, totalNumInputChannels);
+        processSubBlock(buffer, chunkStart, chunkLength, params);
+        _postTone.process(buffer, chunkStart, chunkLength, totalNumInputChannels);
+
+        // the cabinet follows the whole distortion, at the host rate.
+        if (params.cabinet)
+            _convolution.process(buffer, chunkStart, chunkLength, totalNumInputChannels);
+
+        _bypass.mixDry(buffer, chunkStart, chunkLength, totalNumInputChannels);
+    }
+}
+
+template <typename SampleType>
+void Juce_plugin_distortionAudioProcessor::processSubBlock (juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, const ParameterSnapshot& params)
+{
+    auto totalNumInputChannels = getTotalNumInputChannels();
+
+    // advance parameter ramps (nullptr when steady).
+    auto preGain = 1.0f;
+    auto* preGainRamp = advancePreGain(numSamples, params, preGain);
+    auto* outputRamp  = _outputGainSmoother.advance(numSamples);
+
+    // shape the level ahead of the clip point; one gain for all channels, so the pre-gain goes first.
+    auto limited = params.limiter && totalNumInputChannels > 0;
+    if (limited)
+    {
+        for (auto channel = 0; channel < totalNumInputChannels; ++channel)
+            ParameterSmoother::applyGain(buffer.getWritePointer(channel, startSample), numSamples, preGainRamp, preGain);
+
+        _limiter.process(buffer, startSample, numSamples, totalNumInputChannels);
+        preGainRamp = nullptr;
+        preGain = 1.0f;
+    }
+
+    // band drives ramp at the rate the bands are shaped at, once for all channels.
+    if (params.numBands > 1)
+    {
+        auto factor = 1 << params.oversamplingFactor;
+        _multiband.setCrossovers(params.numBands, params.crossoverFrequencies, getSampleRate() * factor);
+        _multiband.setBands(params.bands);
+        _multiband.advance(numSamples * factor);
+    }
+
+    // apply distortion with oversampling.
+    if (_oversampling.isActive() && totalNumInputChannels > 0)
+    {
+        processOversampled(buffer, startSample, numSamples, params, preGainRamp, preGain, outputRamp);
+        return;
+    }
+
+    // the ramps above are shared, so each extra channel only adds its own samples.
+    // the waveshaper table bakes in the steady pre-gain, so it is not used once the limiter has applied it.
+    auto* const* channels = buffer.getArrayOfWritePointers();
+    for (auto channel = 0; channel < totalNumInputChannels; ++channel)
+        shapeChannel(channel, channels[channel] + startSample, numSamples, params, preGainRamp, preGain, outputRamp, params.outputGain, ! limited);
+}
+
+const float* Juce_plugin_distortionAudioProcessor::advancePreGain (int numSamples, const ParameterSnapshot& params, float& preGain) noexcept
+{
+    // every smoother advances, so an unused drive is already in place when the mode switches.
+    auto* inputRamp        = _inputGainSmoother.advance(numSamples);
+    auto* clipDriveRamp    = _clipDriveSmoother.advance(numSamples);
+    auto* specialDriveRamp = _specialDriveSmoother.advance(numSamples);
+
+    // combine input volume and drive into a single pre-gain;
+    // in multiband mode each band applies its own drive, so the pre-gain is the input volume only.
+    auto multiband = params.numBands > 1;
+    auto* driveRamp = multiband ? nullptr : (params.special ? specialDriveRamp : clipDriveRamp);
+    auto drive = multiband ? 1.0f : (params.special ? params.specialDrive : params.inverseThreshold);
+    preGain = params.inputGain * drive;
+
+    if (inputRamp == nullptr && driveRamp == nullptr)
+        return nullptr;
+
+    if (inputRamp != nullptr && driveRamp != nullptr)
+        juce::FloatVectorOperations::multiply(_preGainRamp.get(), inputRamp, driveRamp, numSamples);
+    else if (inputRamp != nullptr)
+        juce::FloatVectorOperations::multiply(_preGainRamp.get(), inputRamp, drive, numSamples);
+    else
+        juce::FloatVectorOperations::multiply(_preGainRamp.get(), driveRamp, params.inputGain, numSamples);
+
+    return _preGainRamp.get();
+}
+
+template <typename SampleType>
+void Juce_plugin_distortionAudioProcessor::shapeChannel (int channel, SampleType* data, int numSamples, const ParameterSnapshot& params,
+                                                         const float* preGainRamp, float preGain, const float* outputRamp, float outputGain, bool tableAllowed) noexcept
+{
+    // clips are counted on the signal that reaches the curve: after the limiter, at the oversampled rate,
+    // and per band in multiband mode; only while the editor shows them.
+    auto metered = _levelMeter.isActive();
+
+    // split into bands, shape each one, and sum them back (ADAA does not apply to the bands).
+    if (params.numBands > 1)
+    {
+        ParameterSmoother::applyGain(data, numSamples, preGainRamp, preGain);
+
+        auto numClipped = _multiband.process(channel, data, numSamples, metered);
+        if (metered)
+            _levelMeter.addClipped(channel, numClipped, numSamples);
+
+        ParameterSmoother::applyGain(data, numSamples, outputRamp, outputGain);
+        return;
+    }
+
+    if (metered)
+        _levelMeter.addClipped(channel, LevelMeter::countClipped(data, numSamples, preGainRamp, preGain), numSamples);
+
+    // antiderivative anti-aliasing keeps its own state, so the gains go around it.
+    if (params.antiAliasing != AntiderivativeShaper::Off)
+    {
+        ParameterSmoother::applyGain(data, numSamples, preGainRamp, preGain);
+        _antiderivativeShaper.process(channel, data, numSamples, params.special ? AntiderivativeShaper::Tanh : AntiderivativeShaper::HardClip, params.antiAliasing);
+        ParameterSmoother::applyGain(data, numSamples, outputRamp, outputGain);
+        return;
+    }
+
+    // special effect or clipping by threshold; the mode is a template argument, so each path is compiled for one curve.
+    if (params.special)
+        processShaped<DistortionCore::Mode::Tanh>(data, numSamples, params, preGainRamp, preGain, outputRamp, outputGain, tableAllowed);
+    else
+        processShaped<DistortionCore::Mode::HardClip>(data, numSamples, params, preGainRamp, preGain, outputRamp, outputGain, tableAllowed);
+}
+
+template <DistortionCore::Mode mode, typename SampleType>
+void Juce_plugin_distortionAudioProcessor::processShaped (SampleType* data, int numSamples, const ParameterSnapshot& params,
+                                                          const float* preGainRamp, float preGain, const float* outputRamp, float outputGain, bool tableAllowed) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    // the waveshaper table bakes in the steady pre-gain of the current Gain, so it only takes the steady tanh.
+    if (mode == DistortionCore::Mode::Tanh && preGainRamp == nullptr && tableAllowed && processTable(data, numSamples, params))
+    {
+        ParameterSmoother::applyGain(data, numSamples, outputRamp, outputGain);
+        return;
+    }
+
+    // pre-gain, shape and output gain in one pass; steady float spans go to the CPU-specific kernels inside the core.
+    auto state = makeCoreState(numSamples, preGainRamp, preGain, outputRamp, outputGain);
+    DistortionCore::process<mode>(data, numSamples, state, *_kernels);
+}
+
+bool Juce_plugin_distortionAudioProcessor::processTable (float* data, int numSamples, const ParameterSnapshot& params) noexcept
+{
+    return _waveshaperTable.process(data, numSamples, params.inputGain, params.specialDrive);
+}
+
+bool Juce_plugin_distortionAudioProcessor::processTable (double* data, int numSamples, const ParameterSnapshot& params) noexcept
+{
+    // the table is a float approximation; the core computes the double curve exactly.
+    juce::ignoreUnused(data, numSamples, params);
+    return false;
+}
+
+template <typename SampleType>
+void Juce_plugin_distortionAudioProcessor::processOversampled (juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, const ParameterSnapshot& params,
+                                                               const float* preGainRamp, float preGain, const float* outputRamp)
+{
+    auto totalNumInputChannels = getTotalNumInputChannels();
+
+    // gains are linear, so they stay at the host rate; only the nonlinearity runs oversampled.
+    for (auto channel = 0; channel < totalNumInputChannels; ++channel)
+        ParameterSmoother::applyGain(buffer.getWritePointer(channel, startSample), numSamples, preGainRamp, preGain);
+
+    auto block = juce::dsp::AudioBlock<SampleType>(buffer)
+                     .getSubsetChannelBlock(0, (size_t) totalNumInputChannels)
+                     .getSubBlock((size_t) startSample, (size_t) numSamples);
+    auto oversampledBlock = _oversampling.processUp(block);
+
+    for (size_t channel = 0; channel < oversampledBlock.getNumChannels(); ++channel)
+        shapeChannel((int) channel, oversampledBlock.getChannelPointer(channel), (int) oversampledBlock.getNumSamples(), params, nullptr, 1.0f, nullptr, 1.0f, false);
+
+    _oversampling.processDown(block);
+
+    // apply output volume.
+    for (auto channel = 0; channel < totalNumInputChannels; ++channel)
+        ParameterSmoother::applyGain(buffer.getWritePointer(channel, startSample), numSamples, outputRamp, params.outputGain);
+}
+
+int Juce_plugin_distortionAudioProcessor::collectParameterEvents (const juce::MidiBuffer& midiMessages, int numSamples) noexcept
+{
+    auto numEvents = 0;
+
+    for (const auto metadata : midiMessages)
+    {
+        auto message = metadata.getMessage();
+
+        if (message.isProgramChange())
+        {
+            // published like the controllers, so the parameters follow the program after the block.
+            auto program = message.getProgramChangeNumber();
+            if (auto* presetValues = _presetBank.getValues(program))
             {
-                channelData[buffNum] = -threshold;
+                _midiProgram = program;
+                for (auto index = 0; index < TotalParameterNum; ++index)
+                {
+                    if (isProgramParameter(index))
+                    {
+                        _pendingParameterValues[(size_t) index] = presetValues[index];
+                        _pendingChangedParameters |= 1u << index;
+                    }
+                }
             }
-            channelData[buffNum] *= (1 / threshold);
+            continue;
         }
+
+        if (! message.isController())
+            continue;
+
+        auto index = _midiControllerParameters[message.getControllerNumber()];
+        if (index < 0)
+            continue;
+
+        auto* parameter = _parameterObjects[index];
+        auto value = parameter->convertFrom0to1((float) message.getControllerValue() / 127.0f);
+
+        // the final value reaches the parameter after the block, even past the event capacity.
+        _pendingParameterValues[(size_t) index] = value;
+        _pendingChangedParameters |= 1u << index;
+
+        if (numEvents < maxParameterEventsPerBlock)
+            _parameterEvents[numEvents++] = { juce::jlimit(0, numSamples, metadata.samplePosition), index, value };
     }
 
-    // apply output volume.
-    buffer.applyGain(pow(getParameter(OutputVolume), 2) * 2.0f);
+    return numEvents;
+}
+
+void Juce_plugin_distortionAudioProcessor::publishParameterEvents() noexcept
+{
+    if (_pendingChangedParameters == 0)
+        return;
+
+    for (auto index = 0; index < TotalParameterNum; ++index)
+    {
+        if ((_pendingChangedParameters & (1u << index)) == 0)
+            continue;
+
+        // later blocks read the value back at once; notifying the host would take locks, so that waits for the timer.
+        auto value = _pendingParameterValues[(size_t) index];
+        _rawParameterValues[index]->store(value, std::memory_order_relaxed);
+
+        int start1, size1, start2, size2;
+        _publishFifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 > 0)
+            _publishQueue[start1] = { index, value };
+        else
+            _publishOverflow.store(true);
+        _publishFifo.finishedWrite(size1);
+    }
+
+    _pendingChangedParameters = 0;
+}
+
+void Juce_plugin_distortionAudioProcessor::timerCallback()
+{
+    if (_latencyChanged.exchange(false))
+        setLatencySamples(getEffectLatencySamples(takeParameterSnapshot()));
+
+    // a MIDI program change moved the current program on the audio thread, so the host's program display follows here.
+    if (_programChanged.exchange(false))
+        updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
+
+    auto publish = [this] (int index, float value)
+    {
+        // the host may have moved the parameter since; its value wins over a stale MIDI change.
+        if (_rawParameterValues[index]->load(std::memory_order_relaxed) != value)
+            return;
+
+        auto* parameter = _parameterObjects[index];
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    };
+
+    int start1, size1, start2, size2;
+    _publishFifo.prepareToRead(_publishFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (auto i = 0; i < size1; ++i)
+        publish(_publishQueue[start1 + i].index, _publishQueue[start1 + i].value);
+    for (auto i = 0; i < size2; ++i)
+        publish(_publishQueue[start2 + i].index, _publishQueue[start2 + i].value);
+
+    _publishFifo.finishedRead(size1 + size2);
+
+    // changes were dropped while the queue was full, so the current values of everything MIDI can move are sent.
+    if (_publishOverflow.exchange(false))
+        for (auto index = 0; index < TotalParameterNum; ++index)
+            if (isProgramParameter(index))
+                publish(index, _rawParameterValues[index]->load(std::memory_order_relaxed));
+}
+
+void Juce_plugin_distortionAudioProcessor::setMidiControllerParameter (int controllerNumber, int parameterIndex) noexcept
+{
+    if (! juce::isPositiveAndBelow(controllerNumber, 128))
+        return;
+
+    _midiControllerParameters[controllerNumber] = isMidiControllable(parameterIndex) ? parameterIndex : -1;
+}
+
+bool Juce_plugin_distortionAudioProcessor::isMidiControllable (int index) noexcept
+{
+    // switching bypass, oversampling or ADAA mid-block would reset filters and report latency from the audio thread.
+    return index == InputVolume || index == Gain || index == OutputVolume || index == Special;
+}
+
+void Juce_plugin_distortionAudioProcessor::setMinimumSubBlockSize (int numSamples) noexcept
+{
+    _minimumSubBlockSize = juce::jmax(1, numSamples);
+}
+
+Juce_plugin_distortionAudioProcessor::ParameterSnapshot Juce_plugin_distortionAudioProcessor::takeParameterSnapshot() const noexcept
+{
+    return makeParameterSnapshot(readParameterValues());
+}
+
+Juce_plugin_distortionAudioProcessor::ParameterValues Juce_plugin_distortionAudioProcessor::readParameterValues() const noexcept
+{
+    // read each atomic exactly once.
+    auto sequence = _programSwitchSequence.load(std::memory_order_acquire);
+
+    ParameterValues values;
+    values[MasterBypass]       = _masterBypassParameter->load(std::memory_order_relaxed);
+    values[InputVolume]        = _inputVolumeParameter->load(std::memory_order_relaxed);
+    values[Gain]               = _gainParameter->load(std::memory_order_relaxed);
+    values[OutputVolume]       = _outputVolumeParameter->load(std::memory_order_relaxed);
+    values[Special]            = _specialParameter->load(std::memory_order_relaxed);
+    values[Oversampling]       = _oversamplingParameter->load(std::memory_order_relaxed);
+    values[OversamplingFilter] = _oversamplingFilterParameter->load(std::memory_order_relaxed);
+    values[AntiAliasing]       = _antiAliasingParameter->load(std::memory_order_relaxed);
+    values[Bands]              = _bandsParameter->load(std::memory_order_relaxed);
+    values[Limiter]            = _limiterParameter->load(std::memory_order_relaxed);
+    values[Lookahead]          = _lookaheadParameter->load(std::memory_order_relaxed);
+    values[Cabinet]            = _cabinetParameter->load(std::memory_order_relaxed);
+    values[PreTilt]            = _preTiltParameter->load(std::memory_order_relaxed);
+    values[PreLowCut]          = _preLowCutParameter->load(std::memory_order_relaxed);
+    values[PreHighCut]         = _preHighCutParameter->load(std::memory_order_relaxed);
+    values[PostTilt]           = _postTiltParameter->load(std::memory_order_relaxed);
+    values[PostLowCut]         = _postLowCutParameter->load(std::memory_order_relaxed);
+    values[PostHighCut]        = _postHighCutParameter->load(std::memory_order_relaxed);
+
+    for (auto i = 0; i < MultibandStage::maxBands - 1; ++i)
+        values[(size_t) (Crossover1 + i)] = _crossoverParameters[i]->load(std::memory_order_relaxed);
+
+    for (auto band = 0; band < MultibandStage::maxBands; ++band)
+    {
+        values[(size_t) (BandGain1 + band)]    = _bandGainParameters[band]->load(std::memory_order_relaxed);
+        values[(size_t) (BandSpecial1 + band)] = _bandSpecialParameters[band]->load(std::memory_order_relaxed);
+    }
+
+    // a program switch overlapped the reads, so some may be old: take the whole program instead.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((sequence & 1u) != 0 || sequence != _programSwitchSequence.load(std::memory_order_relaxed))
+        overlayProgram(_programSwitchIndex.load(), values);
+
+    return values;
+}
+
+Juce_plugin_distortionAudioProcessor::ParameterSnapshot Juce_plugin_distortionAudioProcessor::makeParameterSnapshot (const ParameterValues& values) noexcept
+{
+    ParameterSnapshot params;
+
+    auto inputVolume  = values[InputVolume];
+    auto gain         = values[Gain];
+    auto outputVolume = values[OutputVolume];
+
+    params.bypass  = values[MasterBypass] >= 0.5f;
+    params.special = values[Special] == 1.0f;
+
+    params.oversamplingFactor = (int) values[Oversampling];
+    params.oversamplingFilter = (int) values[OversamplingFilter];
+    params.antiAliasing       = (int) values[AntiAliasing];
+
+    // volume and gain sliders to gains, thresholds and drives.
+    auto staging = DistortionCore::makeGainStaging(inputVolume, gain, outputVolume);
+    auto gainDecibel = (double) staging.gainDecibel;
+
+    params.inputGain        = staging.inputGain;
+    params.outputGain       = staging.outputGain;
+    params.gainDecibel      = staging.gainDecibel;
+    params.threshold        = staging.threshold;
+    params.inverseThreshold = staging.inverseThreshold;
+    params.specialDrive     = staging.specialDrive;
+
+    params.limiter   = values[Limiter] >= 0.5f;
+    params.lookahead = values[Lookahead];
+    params.cabinet   = values[Cabinet] >= 0.5f;
+
+    params.preTone.tilt     = values[PreTilt];
+    params.preTone.lowCut   = values[PreLowCut];
+    params.preTone.highCut  = values[PreHighCut];
+    params.postTone.tilt    = values[PostTilt];
+    params.postTone.lowCut  = values[PostLowCut];
+    params.postTone.highCut = values[PostHighCut];
+
+    // bands: the crossovers may be set in any order, so the bands follow them from low to high.
+    params.numBands = (int) values[Bands] + 1;
+
+    for (auto i = 0; i < MultibandStage::maxBands - 1; ++i)
+        params.crossoverFrequencies[i] = values[(size_t) (Crossover1 + i)];
+    std::sort(std::begin(params.crossoverFrequencies), std::begin(params.crossoverFrequencies) + (params.numBands - 1));
+
+    // each band's gain adds to Gain, and maps to a drive the same way as the single band does.
+    for (auto band = 0; band < MultibandStage::maxBands; ++band)
+    {
+        auto bandGain    = values[(size_t) (BandGain1 + band)];
+        auto bandDecibel = gainDecibel + juce::Decibels::gainToDecibels((double) bandGain * bandGain);
+
+        params.bands[band].special = params.special || values[(size_t) (BandSpecial1 + band)] >= 0.5f;
+        params.bands[band].drive   = (float) (params.bands[band].special ? bandDecibel / 2.0 * 5.0 / 2
+                                                                         : juce::Decibels::decibelsToGain(bandDecibel));
+    }
+
+    return params;
 }
 
 //==============================================================================
 bool Juce_plugin_distortionAudioProcessor::hasEditor() const
 {
+   #if DISTORTION_HEADLESS
+    return false;
+   #else
     return true;
+   #endif
 }
 
 juce::AudioProcessorEditor* Juce_plugin_distortionAudioProcessor::createEditor()
 {
+   #if DISTORTION_HEADLESS
+    return nullptr;
+   #else
     return new Juce_plugin_distortionAudioProcessorEditor (*this, _parameters);
+   #endif
 }
 
 //==============================================================================
 void Juce_plugin_distortionAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // load parameter values.
+    // save parameter values; the block only reallocates when its size differs, so a reused one does not allocate.
+    destData.setSize(stateSize);
+    writeState(destData.getData());
+}
+
+void Juce_plugin_distortionAudioProcessor::writeState (void* dest) const noexcept
+{
+    auto values = readParameterValues();
+    PluginStateFormat::write(dest, values.data(), TotalParameterNum, _currentProgram.load());
+}
+
+void Juce_plugin_distortionAudioProcessor::getXmlStateInformation (juce::MemoryBlock& destData)
+{
     auto state = _parameters.copyState();
     std::unique_ptr<juce::XmlElement> xml(state.createXml());
     copyXmlToBinary(*xml, destData);
@@ -217,7 +1100,28 @@ void Juce_plugin_distortionAudioProcessor::getStateInformation (juce::MemoryBloc
 
 void Juce_plugin_distortionAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // save parameter values.
+    // load parameter values.
+    if (PluginStateFormat::isBinaryState(data, sizeInBytes))
+    {
+        // start from the defaults, so parameters added since the state was saved are reset.
+        ParameterValues values;
+        for (auto index = 0; index < TotalParameterNum; ++index)
+            values[(size_t) index] = _parameterObjects[index]->convertFrom0to1(_parameterObjects[index]->getDefaultValue());
+
+        auto program = _currentProgram.load();
+        if (! PluginStateFormat::read(data, sizeInBytes, values.data(), TotalParameterNum, program))
+            return;
+
+        for (auto index = 0; index < TotalParameterNum; ++index)
+            _parameterObjects[index]->setValueNotifyingHost(_parameterObjects[index]->convertTo0to1(values[(size_t) index]));
+
+        // only the index is restored; the saved values already hold any edits made after the program was chosen.
+        if (_presetBank.getValues(program) != nullptr)
+            _currentProgram.store(program);
+        return;
+    }
+
+    // states saved by earlier versions are XML.
     std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -252,6 +1156,46 @@ float Juce_plugin_distortionAudioProcessor::getParameter(int index)
         return (float)*_outputVolumeParameter;
     case Special:
         return (float)*_specialParameter;
+    case Oversampling:
+        return (float)*_oversamplingParameter;
+    case OversamplingFilter:
+        return (float)*_oversamplingFilterParameter;
+    case AntiAliasing:
+        return (float)*_antiAliasingParameter;
+    case Bands:
+        return (float)*_bandsParameter;
+    case Crossover1:
+    case Crossover2:
+    case Crossover3:
+        return (float)*_crossoverParameters[index - Crossover1];
+    case BandGain1:
+    case BandGain2:
+    case BandGain3:
+    case BandGain4:
+        return (float)*_bandGainParameters[index - BandGain1];
+    case BandSpecial1:
+    case BandSpecial2:
+    case BandSpecial3:
+    case BandSpecial4:
+        return (float)*_bandSpecialParameters[index - BandSpecial1];
+    case Limiter:
+        return (float)*_limiterParameter;
+    case Lookahead:
+        return (float)*_lookaheadParameter;
+    case Cabinet:
+        return (float)*_cabinetParameter;
+    case PreTilt:
+        return (float)*_preTiltParameter;
+    case PreLowCut:
+        return (float)*_preLowCutParameter;
+    case PreHighCut:
+        return (float)*_preHighCutParameter;
+    case PostTilt:
+        return (float)*_postTiltParameter;
+    case PostLowCut:
+        return (float)*_postLowCutParameter;
+    case PostHighCut:
+        return (float)*_postHighCutParameter;
     default:
         return -1.0f;
     }
@@ -271,6 +1215,34 @@ juce::String Juce_plugin_distortionAudioProcessor::getParameterID(int index)
         return std::to_string(OutputVolume);
     case Special:
         return std::to_string(Special);
+    case Oversampling:
+        return std::to_string(Oversampling);
+    case OversamplingFilter:
+        return std::to_string(OversamplingFilter);
+    case AntiAliasing:
+        return std::to_string(AntiAliasing);
+    case Bands:
+    case Crossover1:
+    case Crossover2:
+    case Crossover3:
+    case BandGain1:
+    case BandGain2:
+    case BandGain3:
+    case BandGain4:
+    case BandSpecial1:
+    case BandSpecial2:
+    case BandSpecial3:
+    case BandSpecial4:
+    case Limiter:
+    case Lookahead:
+    case Cabinet:
+    case PreTilt:
+    case PreLowCut:
+    case PreHighCut:
+    case PostTilt:
+    case PostLowCut:
+    case PostHighCut:
+        return std::to_string(index);
     default:
         return "";
     }
@@ -290,6 +1262,46 @@ const juce::String Juce_plugin_distortionAudioProcessor::getParameterName(int in
         return "Out";
     case Special:
         return "Special";
+    case Oversampling:
+        return "Oversampling";
+    case OversamplingFilter:
+        return "Filter";
+    case AntiAliasing:
+        return "ADAA";
+    case Bands:
+        return "Bands";
+    case Crossover1:
+    case Crossover2:
+    case Crossover3:
+        return "Crossover" + juce::String(index - Crossover1 + 1);
+    case BandGain1:
+    case BandGain2:
+    case BandGain3:
+    case BandGain4:
+        return "Gain" + juce::String(index - BandGain1 + 1);
+    case BandSpecial1:
+    case BandSpecial2:
+    case BandSpecial3:
+    case BandSpecial4:
+        return "Special" + juce::String(index - BandSpecial1 + 1);
+    case Limiter:
+        return "Limiter";
+    case Lookahead:
+        return "Lookahead";
+    case Cabinet:
+        return "Cabinet";
+    case PreTilt:
+        return "PreTilt";
+    case PreLowCut:
+        return "PreLowCut";
+    case PreHighCut:
+        return "PreHighCut";
+    case PostTilt:
+        return "PostTilt";
+    case PostLowCut:
+        return "PostLowCut";
+    case PostHighCut:
+        return "PostHighCut";
     default:
         return "";
     }
@@ -301,12 +1313,45 @@ const juce::String Juce_plugin_distortionAudioProcessor::getParameterText(int in
     {
     case MasterBypass:
     case Special:
+    case BandSpecial1:
+    case BandSpecial2:
+    case BandSpecial3:
+    case BandSpecial4:
+    case Limiter:
+    case Cabinet:
         return getParameterName(index);
     case InputVolume:
     case OutputVolume:
         return getParameterName(index) + "\n" + juce::String(juce::Decibels::gainToDecibels(pow(getParameter(index), 2)), 1) + "\ndB";
     case Gain:
+    case BandGain1:
+    case BandGain2:
+    case BandGain3:
+    case BandGain4:
         return getParameterName(index) + "\n" + juce::String(juce::Decibels::gainToDecibels(pow(getParameter(index), 2)), 1) + " dB";
+    case Oversampling:
+        return juce::String(1 << (int) getParameter(index)) + "x";
+    case OversamplingFilter:
+        return getParameter(index) == OversamplingStage::PolyphaseIIR ? "IIR" : "FIR";
+    case AntiAliasing:
+        return getParameter(index) == AntiderivativeShaper::Off ? "Off" : "ADAA" + juce::String((int) getParameter(index));
+    case Bands:
+        return juce::String((int) getParameter(index) + 1);
+    case Crossover1:
+    case Crossover2:
+    case Crossover3:
+        return juce::String(juce::roundToInt(getParameter(index))) + " Hz";
+    case Lookahead:
+        return juce::String(getParameter(index), 1) + " ms";
+    case PreTilt:
+    case PostTilt:
+        return juce::String(getParameter(index), 1) + " dB";
+    case PreLowCut:
+    case PostLowCut:
+        return getParameter(index) <= ToneFilterStage::lowCutOff ? juce::String("Off") : juce::String(juce::roundToInt(getParameter(index))) + " Hz";
+    case PreHighCut:
+    case PostHighCut:
+        return getParameter(index) >= ToneFilterStage::highCutOff ? juce::String("Off") : juce::String(juce::roundToInt(getParameter(index))) + " Hz";
     default:
         return "";
     }
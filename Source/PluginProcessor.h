@@ -9,13 +9,35 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "DistortionKernels.h"
+#include "DistortionCore.h"
+#include "ParameterSmoother.h"
+#include "OversamplingStage.h"
+#include "AntiderivativeShaper.h"
+#include "WaveshaperTable.h"
+#include "RealtimeSafetyChecker.h"
+#include "DspLoadMeter.h"
+#include "LevelMeter.h"
+#include "BypassStage.h"
+#include "PluginStateFormat.h"
+#include "PresetBank.h"
+#include "MultibandStage.h"
+#include "LookaheadLimiter.h"
+#include "ConvolutionStage.h"
+#include "ToneFilterStage.h"
+#include "SilenceDetector.h"
 
 //==============================================================================
 /**
 */
-class Juce_plugin_distortionAudioProcessor  : public juce::AudioProcessor
+class Juce_plugin_distortionAudioProcessor  : public juce::AudioProcessor,
+    private juce::AudioProcessorValueTreeState::Listener,
+    private juce::Timer
 {
 public:
+    // Ήő`l (o͓͂CAEg)
+    static constexpr int maxNumChannels = 64;
+
     //==============================================================================
     Juce_plugin_distortionAudioProcessor();
     ~Juce_plugin_distortionAudioProcessor() override;
@@ -29,6 +51,13 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
+
+    // zXg̃oCpX MasterBypass g
+    juce::AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -56,12 +85,36 @@ public:
     // p[^`
     enum Parameters
     {
-        MasterBypass = 0,  // oCpXON/OFF؂ւ
-        InputVolume,       // ̓{[
-        Gain,              // cݗ(NbsO臒l)
-        OutputVolume,      // o̓{[
-        Special,           // XyV
-        TotalParameterNum, // p[^̍v
+        MasterBypass = 0,   // oCpXON/OFF؂ւ
+        InputVolume,        // ̓{[
+        Gain,               // cݗ(NbsO臒l)
+        OutputVolume,       // o̓{[
+        Special,            // XyV
+        Oversampling,       // I[o[TvO{ (1x/2x/4x/8x)
+        OversamplingFilter, // I[o[TvÕtB^ (IIR/FIR)
+        AntiAliasing,       // ADAA̎ (Off/1st/2nd)
+        Bands,              // }`oh̑ш搔 (1`4A1 ̓VOoh)
+        Crossover1,         // NXI[o[g(Hz) (ш1/2)
+        Crossover2,         // NXI[o[g(Hz) (ш2/3)
+        Crossover3,         // NXI[o[g(Hz) (ш3/4)
+        BandGain1,          // ш悲Ƃ̘cݗ (Gain ɉZ)
+        BandGain2,
+        BandGain3,
+        BandGain4,
+        BandSpecial1,       // ш悲Ƃ̃XyV (Special ON̏ꍇ͑SшON)
+        BandSpecial2,
+        BandSpecial3,
+        BandSpecial4,
+        Limiter,            // ǂ݃~b^[ON/OFF (Nbv̎OŃQC})
+        Lookahead,          // ǂݎ(ms) (CeV[ɂȂ)
+        Cabinet,            // Lrlbg(CpX)̏ݍ݂ON/OFF
+        PreTilt,            // c݂̑Oĩ`g(dB)
+        PreLowCut,          // c݂̑Oĩ[Jbgg(Hz) (OFF)
+        PreHighCut,         // c݂̑OĩnCJbgg(Hz) (OFF)
+        PostTilt,           // č݂ĩ`g(dB)
+        PostLowCut,         // č݂ĩ[Jbgg(Hz) (OFF)
+        PostHighCut,        // č݂ĩnCJbgg(Hz) (OFF)
+        TotalParameterNum,  // p[^̍v
     };
 
     // p[^ڐ
@@ -79,13 +132,266 @@ public:
     // p[^̕\e
     const juce::String getParameterText(int index) override;
 
+    // p[^ω̃v(ms) ( prepareToPlay L)
+    void setParameterRampLength(int index, double milliseconds);
+
+    // oCpX؂ւ̃NXtF[h(ms) ( prepareToPlay L)
+    void setBypassCrossfadeLength(double milliseconds);
+
+    // XyV̔g`e[uݒ ( prepareToPlay L)
+    void setWaveshaperTableOptions(int tableSize, WaveshaperTable::Interpolation interpolation);
+
+    // g`e[ũgp(oCg)
+    size_t getWaveshaperTableMemoryFootprint() const noexcept;
+
+    // processBlock ̕׌v (GfB^Q)
+    DspLoadMeter& getDspLoadMeter() noexcept { return _dspLoadMeter; }
+
+    // o̓x̌v (GfB^Q)
+    LevelMeter& getLevelMeter() noexcept { return _levelMeter; }
+
+    // O̎擾ȍ~ɕωp[^ (bit index = p[^ԍA擾ƃNA)
+    juce::uint32 fetchDirtyParameters() noexcept;
+
+    // MIDI CC ̊蓖 (parameterIndex = -1 ŉAĐ~ɌĂԂ)
+    //  CC21`24 = InputVolume, Gain, OutputVolume, Special (S`l)
+    void setMidiControllerParameter(int controllerNumber, int parameterIndex) noexcept;
+
+    // MIDI CC ŕύXłp[^ (AlƃXyV̂)
+    static bool isMidiControllable(int index) noexcept;
+
+    // p[^ύXŃubN𕪊ŏTv
+    void setMinimumSubBlockSize(int numSamples) noexcept;
+
+    // vZbgŐ؂ւp[^ (MIDI CC ƓAtB^̃Zbg⃌CeV[̕ω)
+    static bool isProgramParameter(int index) noexcept;
+
+    // [U[vZbg̃t@C (NɈxǂ݁At@Ng[vZbǧɒǉ)
+    static juce::File getUserPresetFile();
+
+    // Lrlbg̃CpX̓ǂݍ (ĐOȂ prepareToPlay ̒ŁAĐ͕ʃXbhŏAł؂ւ)
+    void loadImpulseResponse(const juce::File& file);
+
+    // CpX̏łĂ邩 (prepareToPlay ̌Aŏ̃ubN̑OɊmF)
+    bool isImpulseResponseReady() const noexcept;
+
+    // NɓǂރCpX̃t@C (WAV / AIFFAő2b)
+    static juce::File getImpulseResponseFile();
+
+    // ۑԂ̃TCY(oCg)
+    static constexpr size_t stateSize = PluginStateFormat::getSize(TotalParameterNum);
+
+    // Ԃ̏ (dest  stateSize oCgȏAmۂsȂ̂ő̃CX^Ẍꊇۑ)
+    void writeState(void* dest) const noexcept;
+
+    // ` (XML) ł̕ۑ (ȑÕo[Wւ̎󂯓nƃx`}[Np)
+    void getXmlStateInformation(juce::MemoryBlock& destData);
+
 private:
+    // ubNPʂ̃p[^l (processBlock ̐擪ňx擾)
+    struct ParameterSnapshot
+    {
+        bool bypass = false;            // oCpX
+        bool special = false;           // XyV
+        float inputGain = 1.0f;         // ̓QC (XC_[l2)
+        float outputGain = 2.0f;        // o̓QC (XC_[l2 * 2)
+        float gainDecibel = 0.0f;       // cݗ (dB)
+        float threshold = 1.0f;         // NbsO臒l
+        float inverseThreshold = 1.0f;  // 1 / threshold
+        float specialDrive = 0.0f;      // tanh ւ͔̓{ (gainDecibel / 2 * 5 / 2)
+        int oversamplingFactor = 0;     // I[o[TvO{
+        int oversamplingFilter = 0;     // I[o[TvÕtB^
+        int antiAliasing = 0;           // ADAA̎
+        int numBands = 1;               // ш搔 (1 ̓VOoh)
+        float crossoverFrequencies[MultibandStage::maxBands - 1] = {};   // NXI[o[g ()
+        MultibandStage::Band bands[MultibandStage::maxBands];             // ш悲Ƃ̘cݐݒ
+        bool limiter = false;           // ǂ݃~b^[
+        float lookahead = 1.5f;         // ǂݎ(ms)
+        bool cabinet = false;           // Lrlbg̏ݍ
+        ToneFilterStage::Settings preTone;    // c݂̑OĩtB^
+        ToneFilterStage::Settings postTone;   // č݂ĩtB^
+    };
+
+    // p[^̐̒l (p[^ԍ)
+    using ParameterValues = std::array<float, TotalParameterNum>;
+
+    // ubÑp[^ύX (MIDI CC 琶)
+    struct ParameterEvent
+    {
+        int samplePosition = 0;   // ubN擪̈ʒu
+        int index = 0;            // p[^ԍ
+        float value = 0.0f;       // ̒l
+    };
+
+    // p[^l܂Ƃ߂Ď擾
+    ParameterSnapshot takeParameterSnapshot() const noexcept;
+    ParameterValues readParameterValues() const noexcept;
+    static ParameterSnapshot makeParameterSnapshot(const ParameterValues& values) noexcept;
+
+    // p[^ɑ΂郌CeV[ (I[o[TvOAADAAAǂ݂̍v)
+    int getEffectLatencySamples(const ParameterSnapshot& params) const noexcept;
+
+    // ͂~܂Ăo͂܂ł̃Tv (CeV[ƓԂ̌)
+    int getTailSamples(const ParameterSnapshot& params) const noexcept;
+
+    // 蓖Ăꂽ MIDI CC p[^ύXƂĎo (߂l̓Cxg)
+    int collectParameterEvents(const juce::MidiBuffer& midiMessages, int numSamples) noexcept;
+
+    // vZbg̒l values u (vZbgŐ؂ւp[^̂)
+    void overlayProgram(int program, ParameterValues& values) const noexcept;
+
+    // MIDI CC ƃvO`FWɂύXp[^̒lɏ݁AzXgւ̒ʒmbZ[WXbhɓn
+    // (I[fBIXbhAbNmۂsȂ)
+    void publishParameterEvents() noexcept;
+
+    // I[fBIXbhnꂽp[^ύXƃCeṼzXgւ̒ʒm (bZ[WXbh)
+    void timerCallback() override;
+
+    // ubN̏ (float / double )
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midiMessages, bool hostBypassed);
+
+    // p[^̋Ԃ̏ (X[WOڕW̍XVƕ)
+    template <typename SampleType>
+    void processSegment(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, const ParameterSnapshot& params);
+
+    // őubNTCYȉɕubN̏
+    template <typename SampleType>
+    void processSubBlock(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, const ParameterSnapshot& params);
+
+    // ̓QCƔ{̃X[WOi߁Ac݂̑OɊ|{߂ (vꍇ nullptr  preGain ̈l)
+    const float* advancePreGain(int numSamples, const ParameterSnapshot& params, float& preGain) noexcept;
+
+    // 1`l̘cݏ (}`ohAADAAAXyVENbv̐U蕪)
+    template <typename SampleType>
+    void shapeChannel(int channel, SampleType* data, int numSamples, const ParameterSnapshot& params,
+                      const float* preGainRamp, float preGain, const float* outputRamp, float outputGain, bool tableAllowed) noexcept;
+
+    // I[o[TvOcݏ
+    template <typename SampleType>
+    void processOversampled(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, const ParameterSnapshot& params,
+                            const float* preGainRamp, float preGain, const float* outputRamp);
+
+    // c݂̎ނƂ̏ (v DistortionCore::State ɂ1pXŏA͔{ float ̓RACPUʃJ[l)
+    template <DistortionCore::Mode mode, typename SampleType>
+    void processShaped(SampleType* data, int numSamples, const ParameterSnapshot& params,
+                       const float* preGainRamp, float preGain, const float* outputRamp, float outputGain, bool tableAllowed) noexcept;
+
+    // g`e[uł̃XyV̏ (݂ Gain ̃e[uꍇ double  false)
+    bool processTable(float* data, int numSamples, const ParameterSnapshot& params) noexcept;
+    bool processTable(double* data, int numSamples, const ParameterSnapshot& params) noexcept;
+
+    // p[^ύX̒ʒm (GfB^ւ̕ύXʒmAg`e[u̍ĐvACeV[̒ʒm)
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+
     juce::AudioProcessorValueTreeState _parameters;
     std::atomic<float>* _masterBypassParameter = nullptr;
     std::atomic<float>* _inputVolumeParameter = nullptr;
     std::atomic<float>* _gainParameter = nullptr;
     std::atomic<float>* _outputVolumeParameter = nullptr;
     std::atomic<float>* _specialParameter = nullptr;
+    std::atomic<float>* _oversamplingParameter = nullptr;
+    std::atomic<float>* _oversamplingFilterParameter = nullptr;
+    std::atomic<float>* _antiAliasingParameter = nullptr;
+    std::atomic<float>* _bandsParameter = nullptr;
+    std::atomic<float>* _crossoverParameters[MultibandStage::maxBands - 1] = {};
+    std::atomic<float>* _bandGainParameters[MultibandStage::maxBands] = {};
+    std::atomic<float>* _bandSpecialParameters[MultibandStage::maxBands] = {};
+    std::atomic<float>* _limiterParameter = nullptr;
+    std::atomic<float>* _lookaheadParameter = nullptr;
+    std::atomic<float>* _cabinetParameter = nullptr;
+    std::atomic<float>* _preTiltParameter = nullptr;
+    std::atomic<float>* _preLowCutParameter = nullptr;
+    std::atomic<float>* _preHighCutParameter = nullptr;
+    std::atomic<float>* _postTiltParameter = nullptr;
+    std::atomic<float>* _postLowCutParameter = nullptr;
+    std::atomic<float>* _postHighCutParameter = nullptr;
+    juce::RangedAudioParameter* _parameterObjects[TotalParameterNum] = {};
+
+    // MIDI CC ɂp[^ύX
+    static constexpr int maxParameterEventsPerBlock = 256;
+    int _midiControllerParameters[128];                 // CCԍ -> p[^ԍ (-1 ͖蓖)
+    ParameterEvent _parameterEvents[maxParameterEventsPerBlock];
+    ParameterValues _pendingParameterValues {};        // ubNōŌɎ󂯂l (CC ƃvO`FW)
+    juce::uint32 _pendingChangedParameters = 0;        // ubNŕύXꂽp[^
+    int _minimumSubBlockSize = 32;
+
+    // zXgւ̒ʒm҂̃p[^ύX (I[fBIXbh -> ^C}[APꐶYҁEP)
+    struct PublishedParameter
+    {
+        int index = 0;
+        float value = 0.0f;
+    };
+
+    static constexpr int publishQueueSize = 512;
+    juce::AbstractFifo _publishFifo { publishQueueSize };
+    PublishedParameter _publishQueue[publishQueueSize];
+    std::atomic<bool> _publishOverflow { false };          // L[ꂽ (Sp[^ʒm)
+    std::atomic<float>* _rawParameterValues[TotalParameterNum] = {};
+
+    // vZbg (vO)
+    PresetBank _presetBank;
+    std::atomic<int> _currentProgram { 0 };
+    std::atomic<int> _programSwitchIndex { -1 };              // zXg؂ւ̃vO
+    std::atomic<juce::uint32> _programSwitchSequence { 0 };   // ؂ւ͊
+    int _midiProgram = -1;                                    // ubNŎ󂯂vO`FW
+
+    // GfB^ɖf̃p[^ (1p[^1rbg)
+    std::atomic<juce::uint32> _dirtyParameters { 0 };
+    static_assert (TotalParameterNum <= 32, "dirty parameter mask is 32 bits");
+
+    // zXgւ̕񍐑҂̃CeVύXEMIDIɂvO̕ύX (^C}[ŕ񍐂)
+    std::atomic<bool> _latencyChanged { false };
+    std::atomic<bool> _programChanged { false };
+
+    // CPUɉđIcݏJ[l
+    const DistortionKernels::KernelSet* _kernels = nullptr;
+
+    // p[^̃X[WO
+    ParameterSmoother _inputGainSmoother;
+    ParameterSmoother _clipDriveSmoother;       // 1 / threshold
+    ParameterSmoother _specialDriveSmoother;    // tanh ւ͔̓{
+    ParameterSmoother _outputGainSmoother;
+    juce::HeapBlock<float> _preGainRamp;        // ̓QC * ͔{
+    int _maximumBlockSize = 0;
+
+    // cݏ̃I[o[TvO
+    OversamplingStage _oversampling;
+
+    // cݏADAA
+    AntiderivativeShaper _antiderivativeShaper;
+    int _antiAliasingOrder = AntiderivativeShaper::Off;   // ÕubNADAA
+
+    // }`oh̑ш敪Ƒш悲Ƃ̘cݏ
+    MultibandStage _multiband;
+
+    // NbvO̐ǂ݃~b^[
+    LookaheadLimiter _limiter;
+    bool _limiterActive = false;    // ÕubNŎgp
+
+    // c݂̑OiEĩtB^
+    ToneFilterStage _preTone;
+    ToneFilterStage _postTone;
+
+    // č݂ĩLrlbgݍ
+    ConvolutionStage _convolution;
+    bool _cabinetActive = false;    // ÕubNŎgp
+
+    // XyV̔g`e[u
+    WaveshaperTable _waveshaperTable;
+
+    // oCpX (NXtF[hƃCeV[⏞)
+    BypassStage _bypass;
+
+    // ̓͂̏̏ȗ
+    SilenceDetector _silenceDetector;
+
+    // processBlock ̕׌v
+    DspLoadMeter _dspLoadMeter;
+
+    // s[NERMSENbv̌v
+    LevelMeter _levelMeter;
+    static_assert (LevelMeter::maxChannels >= maxNumChannels, "meter every supported channel");
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Juce_plugin_distortionAudioProcessor)
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    PluginStateFormat.cpp
+    Compact, versioned binary layout for the plugin state.
+
+  ==============================================================================
+*/
+
+#include "PluginStateFormat.h"
+
+namespace
+{
+template <typename IntegerType>
+void writeLittleEndian (char* dest, IntegerType value) noexcept
+{
+    value = juce::ByteOrder::swapIfBigEndian(value);
+    std::memcpy(dest, &value, sizeof(value));
+}
+
+// converts values saved by an older version in place.
+// parameters are only ever appended and version 2 only adds the program index, so nothing needs
+// converting yet; a version that rescales or reorders a parameter adds a case here for every older version.
+void migrate (int version, float* values, int numValues) noexcept
+{
+    juce::ignoreUnused(version, values, numValues);
+}
+}
+
+bool PluginStateFormat::isBinaryState (const void* data, int sizeInBytes) noexcept
+{
+    return data != nullptr
+        && sizeInBytes >= headerSize
+        && juce::ByteOrder::littleEndianInt(data) == magic;
+}
+
+void PluginStateFormat::write (void* dest, const float* values, int numValues, int program) noexcept
+{
+    auto* bytes = static_cast<char*>(dest);
+    writeLittleEndian(bytes, magic);
+    writeLittleEndian(bytes + 4, (juce::uint16) currentVersion);
+    writeLittleEndian(bytes + 6, (juce::uint16) numValues);
+
+    for (auto i = 0; i < numValues; ++i)
+    {
+        juce::uint32 bits;
+        std::memcpy(&bits, values + i, sizeof(bits));
+        writeLittleEndian(bytes + headerSize + 4 * i, bits);
+    }
+
+    writeLittleEndian(bytes + headerSize + 4 * numValues, (juce::int32) program);
+}
+
+bool PluginStateFormat::read (const void* data, int sizeInBytes, float* values, int numValues, int& program) noexcept
+{
+    if (! isBinaryState(data, sizeInBytes))
+        return false;
+
+    auto* bytes = static_cast<const char*>(data);
+    auto version = (int) juce::ByteOrder::littleEndianShort(bytes + 4);
+    auto numStoredValues = (int) juce::ByteOrder::littleEndianShort(bytes + 6);
+
+    // a newer layout may mean something else by the same bytes, so it is not guessed at.
+    // version 1 ends after the values, without the program index.
+    auto storedSize = version >= 2 ? getSize(numStoredValues) : getSize(numStoredValues) - sizeof(juce::int32);
+    if (version < 1 || version > currentVersion || (size_t) sizeInBytes < storedSize)
+        return false;
+
+    // values beyond the parameters this build knows are ignored; missing ones keep their defaults.
+    for (auto i = 0; i < juce::jmin(numValues, numStoredValues); ++i)
+    {
+        auto bits = juce::ByteOrder::littleEndianInt(bytes + headerSize + 4 * i);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+
+        if (std::isfinite(value))
+            values[i] = value;
+    }
+
+    if (version >= 2)
+        program = (int) (juce::int32) juce::ByteOrder::littleEndianInt(bytes + headerSize + 4 * numStoredValues);
+
+    migrate(version, values, numValues);
+    return true;
+}
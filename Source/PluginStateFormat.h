@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    PluginStateFormat.h
+    Compact, versioned binary layout for the plugin state.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// CAEg (gGfBA)
+//   uint32  magic        "WDST"
+//   uint16  version      񂾂Ƃ currentVersion
+//   uint16  numValues    p[^
+//   float32 values[]     p[^ԍ̐̒l
+//   int32   program      ݂̃vOԍ (o[W 2 ȍ~)
+namespace PluginStateFormat
+{
+    // 擪̎ʎq (copyXmlToBinary ̎ʎqƂ͈قȂ)
+    constexpr juce::uint32 magic = 0x54534457;   // "WDST"
+
+    // ݂̃o[W (l̈ӖтςꍇɏグAmigrate ɕϊǉ)
+    constexpr int currentVersion = 2;
+
+    // wb_̃TCY(oCg)
+    constexpr int headerSize = 8;
+
+    // numValues ̃p[^ƃvOԍۑTCY(oCg)
+    constexpr size_t getSize(int numValues) noexcept { return (size_t) headerSize + sizeof(float) * (size_t) numValues + sizeof(juce::int32); }
+
+    // oCi` (false ̏ꍇ͋` XML Ƃēǂ)
+    bool isBinaryState(const void* data, int sizeInBytes) noexcept;
+
+    //  (dest ɂ getSize(numValues) oCgȏオKvAmۂ͍sȂ)
+    void write(void* dest, const float* values, int numValues, int program) noexcept;
+
+    // ǂݍ (values ɂ͊lĂAۑɒǉꂽp[^͊l̂܂܎c)
+    // program ̓vOԍۑĂȂo[W 1 ̏ꍇ͕ύXȂ
+    // Ăꍇ▢m̐Vo[W̏ꍇ false
+    bool read(const void* data, int sizeInBytes, float* values, int numValues, int& program) noexcept;
+}
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+    Preset table parsed once, read by index from any thread.
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+void PresetBank::setParameters (const juce::StringArray& parameterNames, const float* defaultValues)
+{
+    _parameterNames = parameterNames;
+    _defaultValues.assign(defaultValues, defaultValues + parameterNames.size());
+    _names.clear();
+    _values.clear();
+}
+
+int PresetBank::parse (const juce::String& text)
+{
+    auto numAdded = 0;
+
+    for (auto line : juce::StringArray::fromLines(text))
+    {
+        line = line.upToFirstOccurrenceOf("#", false, false).trim();
+        if (! line.containsChar(':'))
+            continue;
+
+        auto name = line.upToFirstOccurrenceOf(":", false, false).trim();
+        if (name.isEmpty())
+            continue;
+
+        // every preset row is complete, so applying one never depends on the previous program.
+        auto row = _values.size();
+        _values.insert(_values.end(), _defaultValues.begin(), _defaultValues.end());
+
+        auto assignments = juce::StringArray::fromTokens(line.fromFirstOccurrenceOf(":", false, false), " \t,", "");
+        for (auto& assignment : assignments)
+        {
+            auto index = _parameterNames.indexOf(assignment.upToFirstOccurrenceOf("=", false, false).trim(), true);
+            auto value = assignment.fromFirstOccurrenceOf("=", false, false).trim();
+
+            // unknown names and non-numbers are skipped rather than failing the whole bank.
+            if (index >= 0 && value.containsOnly("+-.0123456789eE") && value.isNotEmpty())
+                _values[row + (size_t) index] = value.getFloatValue();
+        }
+
+        _names.add(name);
+        ++numAdded;
+    }
+
+    return numAdded;
+}
+
+int PresetBank::loadFile (const juce::File& file)
+{
+    juce::MemoryMappedFile mappedFile(file, juce::MemoryMappedFile::readOnly);
+    if (mappedFile.getData() == nullptr)
+        return 0;
+
+    return parse(juce::String::fromUTF8(static_cast<const char*>(mappedFile.getData()), (int) mappedFile.getSize()));
+}
+
+juce::String PresetBank::getName (int index) const
+{
+    return _names[index];
+}
+
+void PresetBank::setName (int index, const juce::String& newName)
+{
+    if (juce::isPositiveAndBelow(index, _names.size()))
+        _names.set(index, newName);
+}
+
+const float* PresetBank::getValues (int index) const noexcept
+{
+    if (! juce::isPositiveAndBelow(index, _names.size()))
+        return nullptr;
+
+    return _values.data() + (size_t) index * (size_t) _parameterNames.size();
+}
@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    Preset table parsed once, read by index from any thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// eLXg` (1s1vZbgA# ȍ~̓RgAw̖p[^͊l)
+//   O: In=1.0 Gain=1.5 Special=1
+class PresetBank
+{
+public:
+    // p[^Ɗl̐ݒ (vZbg̒ǉOɌĂ)
+    void setParameters(const juce::StringArray& parameterNames, const float* defaultValues);
+
+    // eLXgvZbgǉ (߂l͒ǉ)
+    int parse(const juce::String& text);
+
+    // t@CvZbgǉ (}bvēǂށAǂ߂Ȃꍇ 0)
+    int loadFile(const juce::File& file);
+
+    // vZbg
+    int getNumPresets() const noexcept { return _names.size(); }
+
+    // vZbg
+    juce::String getName(int index) const;
+
+    // vZbg̕ύX
+    void setName(int index, const juce::String& newName);
+
+    // vZbg̒l (p[^ԍA͈͊Ȍꍇ nullptr)
+    // ǉI͕ύXȂ̂ŁAI[fBIXbhǂ߂
+    const float* getValues(int index) const noexcept;
+
+private:
+    juce::StringArray _parameterNames;
+    std::vector<float> _defaultValues;
+    juce::StringArray _names;
+    std::vector<float> _values;     // vZbg x p[^
+};
@@ -0,0 +1,439 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyChecker.cpp
+    Debug/test hooks that catch heap use and mutex locks on the audio thread.
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafetyChecker.h"
+
+#if DISTORTION_REALTIME_CHECKS
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_LINUX && defined (__GLIBC__)
+ #include <dlfcn.h>
+ #include <pthread.h>
+ // glibc lets the executable interpose the allocator and the pthread locks and waits, which also catches C allocations,
+ // every operator new (libstdc++ builds the aligned ones on aligned_alloc), every juce::CriticalSection and std::mutex.
+ #define DISTORTION_HOOK_GLIBC 1
+#else
+ // elsewhere only the C++ allocation operators can be replaced portably.
+ #define DISTORTION_HOOK_GLIBC 0
+#endif
+
+namespace RealtimeSafetyChecker
+{
+namespace
+{
+    thread_local int realtimeDepth = 0;
+    thread_local bool reporting = false;
+
+    std::atomic<int> numViolations[TotalViolationNum] {};
+    std::atomic<bool> abortOnViolation { true };
+
+    const char* const violationNames[TotalViolationNum] =
+    {
+        "heap allocation",
+        "heap deallocation",
+        "mutex lock",
+        "condition wait",
+    };
+
+    void report (Violation violation) noexcept
+    {
+        // the report itself may allocate or lock (stdio), which must not re-enter here.
+        if (realtimeDepth == 0 || reporting)
+            return;
+
+        reporting = true;
+        numViolations[violation].fetch_add(1);
+        std::fprintf(stderr, "RealtimeSafetyChecker: %s inside processBlock\n", violationNames[violation]);
+
+        if (abortOnViolation.load())
+            std::abort();
+
+        reporting = false;
+    }
+}
+
+ScopedRealtimeSection::ScopedRealtimeSection() noexcept
+{
+    ++realtimeDepth;
+}
+
+ScopedRealtimeSection::~ScopedRealtimeSection() noexcept
+{
+    --realtimeDepth;
+}
+
+void setAbortOnViolation (bool shouldAbort) noexcept
+{
+    abortOnViolation.store(shouldAbort);
+}
+
+int getNumViolations (Violation violation) noexcept
+{
+    return numViolations[violation].load();
+}
+
+void resetViolations() noexcept
+{
+    for (auto& count : numViolations)
+        count.store(0);
+}
+
+const char* getHookedFunctions() noexcept
+{
+   #if DISTORTION_HOOK_GLIBC
+    return "malloc, calloc, realloc, reallocarray, free, posix_memalign, aligned_alloc, memalign, valloc, pvalloc "
+           "(and so every operator new/delete), pthread_mutex_lock/trylock/timedlock/clocklock, "
+           "pthread_rwlock_rdlock/tryrdlock/timedrdlock/clockrdlock/wrlock/trywrlock/timedwrlock/clockwrlock, "
+           "pthread_cond_wait/timedwait/clockwait";
+   #elif __cpp_aligned_new
+    return "operator new/delete (plain and aligned); C allocations and locks are not hooked on this platform";
+   #else
+    return "operator new/delete; C allocations and locks are not hooked on this platform";
+   #endif
+}
+}
+
+//==============================================================================
+#if DISTORTION_HOOK_GLIBC
+
+namespace
+{
+    // the definition this executable hides, i.e. the one in libc.
+    template <typename Function>
+    Function findNext (const char* name) noexcept
+    {
+        return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+    }
+
+    using MutexFunction = int (*) (pthread_mutex_t*);
+    using RWLockFunction = int (*) (pthread_rwlock_t*);
+    using TimedRWLockFunction = int (*) (pthread_rwlock_t*, const timespec*);
+    using ClockRWLockFunction = int (*) (pthread_rwlock_t*, clockid_t, const timespec*);
+}
+
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void* __libc_valloc (size_t);
+    void* __libc_pvalloc (size_t);
+    void __libc_free (void*);
+
+    void* malloc (size_t size)
+    {
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+        return __libc_malloc(size);
+    }
+
+    void* calloc (size_t count, size_t size)
+    {
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc (void* pointer, size_t size)
+    {
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+        return __libc_realloc(pointer, size);
+    }
+
+    void* reallocarray (void* pointer, size_t count, size_t size)
+    {
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+
+        size_t total;
+        if (__builtin_mul_overflow(count, size, &total))
+        {
+            errno = ENOMEM;
+            return nullptr;
+        }
+
+        return __libc_realloc(pointer, total);
+    }
+
+    int posix_memalign (void** pointer, size_t alignment, size_t size)
+    {
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+
+        // the same checks glibc makes before it hands over to memalign.
+        if (alignment == 0 || alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+
+        auto* result = __libc_memalign(alignment, size);
+        if (result == nullptr)
+            return ENOMEM;
+
+        *pointer = result;
+        return 0;
+    }
+
+    void* aligned_alloc (size_t alignment, size_t size)
+    {
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* memalign (size_t alignment, size_t size)
+    {
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* valloc (size_t size)
+    {
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+        return __libc_valloc(size);
+    }
+
+    void* pvalloc (size_t size)
+    {
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+        return __libc_pvalloc(size);
+    }
+
+    void free (void* pointer)
+    {
+        if (pointer != nullptr)
+            RealtimeSafetyChecker::report(RealtimeSafetyChecker::Deallocation);
+
+        __libc_free(pointer);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex)
+    {
+        static const auto realLock = findNext<MutexFunction>("pthread_mutex_lock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(mutex);
+    }
+
+    // a lock that happens not to be contended is still one that can be on a bad block.
+    int pthread_mutex_trylock (pthread_mutex_t* mutex)
+    {
+        static const auto realLock = findNext<MutexFunction>("pthread_mutex_trylock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(mutex);
+    }
+
+    int pthread_mutex_timedlock (pthread_mutex_t* mutex, const timespec* timeout)
+    {
+        using TimedLockFunction = int (*) (pthread_mutex_t*, const timespec*);
+        static const auto realLock = findNext<TimedLockFunction>("pthread_mutex_timedlock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(mutex, timeout);
+    }
+
+    // the clock* variants (glibc 2.30) are what libstdc++ uses for timeouts on std::chrono::steady_clock.
+    int pthread_mutex_clocklock (pthread_mutex_t* mutex, clockid_t clock, const timespec* timeout)
+    {
+        using ClockLockFunction = int (*) (pthread_mutex_t*, clockid_t, const timespec*);
+        static const auto realLock = findNext<ClockLockFunction>("pthread_mutex_clocklock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(mutex, clock, timeout);
+    }
+
+    int pthread_rwlock_rdlock (pthread_rwlock_t* lock)
+    {
+        static const auto realLock = findNext<RWLockFunction>("pthread_rwlock_rdlock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(lock);
+    }
+
+    int pthread_rwlock_tryrdlock (pthread_rwlock_t* lock)
+    {
+        static const auto realLock = findNext<RWLockFunction>("pthread_rwlock_tryrdlock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(lock);
+    }
+
+    int pthread_rwlock_timedrdlock (pthread_rwlock_t* lock, const timespec* timeout)
+    {
+        static const auto realLock = findNext<TimedRWLockFunction>("pthread_rwlock_timedrdlock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(lock, timeout);
+    }
+
+    int pthread_rwlock_clockrdlock (pthread_rwlock_t* lock, clockid_t clock, const timespec* timeout)
+    {
+        static const auto realLock = findNext<ClockRWLockFunction>("pthread_rwlock_clockrdlock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(lock, clock, timeout);
+    }
+
+    int pthread_rwlock_wrlock (pthread_rwlock_t* lock)
+    {
+        static const auto realLock = findNext<RWLockFunction>("pthread_rwlock_wrlock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(lock);
+    }
+
+    int pthread_rwlock_trywrlock (pthread_rwlock_t* lock)
+    {
+        static const auto realLock = findNext<RWLockFunction>("pthread_rwlock_trywrlock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(lock);
+    }
+
+    int pthread_rwlock_timedwrlock (pthread_rwlock_t* lock, const timespec* timeout)
+    {
+        static const auto realLock = findNext<TimedRWLockFunction>("pthread_rwlock_timedwrlock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(lock, timeout);
+    }
+
+    int pthread_rwlock_clockwrlock (pthread_rwlock_t* lock, clockid_t clock, const timespec* timeout)
+    {
+        static const auto realLock = findNext<ClockRWLockFunction>("pthread_rwlock_clockwrlock");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::MutexLock);
+        return realLock(lock, clock, timeout);
+    }
+
+    // dlsym finds the default version, the same one callers built against current glibc bind to.
+    int pthread_cond_wait (pthread_cond_t* condition, pthread_mutex_t* mutex)
+    {
+        using WaitFunction = int (*) (pthread_cond_t*, pthread_mutex_t*);
+        static const auto realWait = findNext<WaitFunction>("pthread_cond_wait");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::ConditionWait);
+        return realWait(condition, mutex);
+    }
+
+    int pthread_cond_timedwait (pthread_cond_t* condition, pthread_mutex_t* mutex, const timespec* timeout)
+    {
+        using TimedWaitFunction = int (*) (pthread_cond_t*, pthread_mutex_t*, const timespec*);
+        static const auto realWait = findNext<TimedWaitFunction>("pthread_cond_timedwait");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::ConditionWait);
+        return realWait(condition, mutex, timeout);
+    }
+
+    int pthread_cond_clockwait (pthread_cond_t* condition, pthread_mutex_t* mutex, clockid_t clock, const timespec* timeout)
+    {
+        using ClockWaitFunction = int (*) (pthread_cond_t*, pthread_mutex_t*, clockid_t, const timespec*);
+        static const auto realWait = findNext<ClockWaitFunction>("pthread_cond_clockwait");
+
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::ConditionWait);
+        return realWait(condition, mutex, clock, timeout);
+    }
+}
+
+#else
+
+void* operator new (size_t size)
+{
+    RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+
+    if (auto* pointer = std::malloc(size == 0 ? 1 : size))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete (void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Deallocation);
+
+    std::free(pointer);
+}
+
+void operator delete[] (void* pointer) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete (void* pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete[] (void* pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+#if __cpp_aligned_new
+// over-aligned types (e.g. SIMD members) bypass the plain operators above.
+void* operator new (size_t size, std::align_val_t alignment)
+{
+    RealtimeSafetyChecker::report(RealtimeSafetyChecker::Allocation);
+
+    auto bytes = size == 0 ? 1 : size;
+    auto align = juce::jmax((size_t) alignment, sizeof(void*));
+
+   #if JUCE_WINDOWS
+    if (auto* pointer = _aligned_malloc(bytes, align))
+        return pointer;
+   #else
+    void* pointer = nullptr;
+    if (posix_memalign(&pointer, align, bytes) == 0)
+        return pointer;
+   #endif
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete (void* pointer, std::align_val_t) noexcept
+{
+    if (pointer != nullptr)
+        RealtimeSafetyChecker::report(RealtimeSafetyChecker::Deallocation);
+
+   #if JUCE_WINDOWS
+    _aligned_free(pointer);
+   #else
+    std::free(pointer);
+   #endif
+}
+
+void operator delete[] (void* pointer, std::align_val_t alignment) noexcept
+{
+    operator delete(pointer, alignment);
+}
+
+void operator delete (void* pointer, size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(pointer, alignment);
+}
+
+void operator delete[] (void* pointer, size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(pointer, alignment);
+}
+#endif
+
+#endif
+
+#endif
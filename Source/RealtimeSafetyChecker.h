@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyChecker.h
+    Debug/test hooks that catch heap use and mutex locks on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// 1 ɂ malloc/free ƃbNEϐ̑ҋ@tbN
+// (tbN̓vZXŜɌ߁Ast@C̃rhł̂ݗLɂ邱)
+#ifndef DISTORTION_REALTIME_CHECKS
+ #define DISTORTION_REALTIME_CHECKS 0
+#endif
+
+namespace RealtimeSafetyChecker
+{
+    // ᔽ̎
+    enum Violation
+    {
+        Allocation = 0,  // malloc / new
+        Deallocation,    // free / delete
+        MutexLock,       // pthread_mutex_lock / trylock / timedlock / clocklock, pthread_rwlock_*
+        ConditionWait,   // pthread_cond_wait / timedwait / clockwait
+        TotalViolationNum,
+    };
+
+   #if DISTORTION_REALTIME_CHECKS
+    // ݂̃XbhA^CԂɂ (processBlock ̐擪Ŏg)
+    class ScopedRealtimeSection
+    {
+    public:
+        ScopedRealtimeSection() noexcept;
+        ~ScopedRealtimeSection() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtimeSection)
+    };
+
+    // ᔽ abort 邩 ( true)
+    void setAbortOnViolation(bool shouldAbort) noexcept;
+
+    // ܂łɌoᔽ̐
+    int getNumViolations(Violation violation) noexcept;
+
+    // ᔽ̃NA
+    void resetViolations() noexcept;
+
+    // ̃vbgtH[ŃtbNĂ֐̈ꗗ (ɂȂĂяo͌ołȂ)
+    const char* getHookedFunctions() noexcept;
+   #else
+    // `FbN͉Ȃ
+    class ScopedRealtimeSection
+    {
+    public:
+        ScopedRealtimeSection() noexcept {}
+    };
+
+    inline void setAbortOnViolation(bool) noexcept {}
+    inline int getNumViolations(Violation) noexcept { return 0; }
+    inline void resetViolations() noexcept {}
+    inline const char* getHookedFunctions() noexcept { return "none"; }
+   #endif
+
+    // tbNgݍ܂Ă邩
+    constexpr bool isEnabled() noexcept { return DISTORTION_REALTIME_CHECKS != 0; }
+}
@@ -0,0 +1,36 @@
+/*
+  ==============================================================================
+
+    SilenceDetector.cpp
+    Skips processing of silent input once the internal state has decayed.
+
+  ==============================================================================
+*/
+
+#include "SilenceDetector.h"
+
+template <typename SampleType>
+bool SilenceDetector::process (const juce::AudioBuffer<SampleType>& buffer, int numChannels, int tailSamples) noexcept
+{
+    auto numSamples = buffer.getNumSamples();
+    numChannels = juce::jmin(numChannels, buffer.getNumChannels());
+
+    // the first loud channel ends the scan, so only silent blocks pay for every channel.
+    for (auto channel = 0; channel < numChannels; ++channel)
+    {
+        if (buffer.getMagnitude(channel, 0, numSamples) >= (SampleType) threshold)
+        {
+            _silentSamples = 0;
+            return false;
+        }
+    }
+
+    // the blocks counted so far were processed, so every delay line and filter has been fed
+    // that much silence; once it covers the tail, what is left inside is silence as well.
+    auto settled = _silentSamples >= tailSamples;
+    _silentSamples += numSamples;
+    return settled;
+}
+
+template bool SilenceDetector::process<float> (const juce::AudioBuffer<float>&, int, int) noexcept;
+template bool SilenceDetector::process<double> (const juce::AudioBuffer<double>&, int, int) noexcept;
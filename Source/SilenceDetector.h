@@ -0,0 +1,29 @@
+/*
+  ==============================================================================
+
+    SilenceDetector.h
+    Skips processing of silent input once the internal state has decayed.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class SilenceDetector
+{
+public:
+    // Ƃ݂Ȃ͂̃s[N (-120dB)
+    static constexpr float threshold = 1.0e-6f;
+
+    // Ԃ̃NA (̖琔)
+    void reset() noexcept { _silentSamples = 0; }
+
+    // ubN̓͂𒲂ׁAtailSamples ȏ̖̌Ăꍇ true (ȗł)
+    template <typename SampleType>
+    bool process(const juce::AudioBuffer<SampleType>& buffer, int numChannels, int tailSamples) noexcept;
+
+private:
+    juce::int64 _silentSamples = 0;     // AĖ͂̃Tv
+};
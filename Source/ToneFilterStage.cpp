@@ -0,0 +1,329 @@
+/*
+  ==============================================================================
+
+    ToneFilterStage.cpp
+    Tilt / low-cut / high-cut biquad cascade, several channels per SIMD vector.
+
+  ==============================================================================
+*/
+
+#include "ToneFilterStage.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#elif JUCE_ARM && (defined (__ARM_NEON__) || defined (__ARM_NEON))
+ #include <arm_neon.h>
+ #define DISTORTION_USE_NEON 1
+#endif
+
+namespace
+{
+//==============================================================================
+// one lane per channel; every lane runs the same instructions with the same coefficients.
+// double lanes take two 2-wide vectors, so a group is still 4 channels in either precision.
+constexpr int vectorLanes = 4;
+
+// plain arrays where there are no vectors of that precision; the compiler is left to vectorize the lane loops.
+template <typename Scalar>
+struct ScalarLanes { Scalar v[vectorLanes]; };
+
+template <typename Scalar, typename Function>
+inline ScalarLanes<Scalar> eachLane (ScalarLanes<Scalar> a, ScalarLanes<Scalar> b, Function&& function) noexcept
+{
+    for (auto lane = 0; lane < vectorLanes; ++lane)
+        a.v[lane] = function(a.v[lane], b.v[lane]);
+    return a;
+}
+
+template <typename Scalar>
+inline ScalarLanes<Scalar> loadLanes (const Scalar* data) noexcept    { ScalarLanes<Scalar> v; std::copy(data, data + vectorLanes, v.v); return v; }
+template <typename Scalar>
+inline void storeLanes (Scalar* data, ScalarLanes<Scalar> v) noexcept { std::copy(v.v, v.v + vectorLanes, data); }
+template <typename Scalar>
+inline ScalarLanes<Scalar> broadcast (Scalar value) noexcept          { ScalarLanes<Scalar> v; std::fill(v.v, v.v + vectorLanes, value); return v; }
+template <typename Scalar>
+inline ScalarLanes<Scalar> add (ScalarLanes<Scalar> a, ScalarLanes<Scalar> b) noexcept      { return eachLane(a, b, [] (Scalar x, Scalar y) { return x + y; }); }
+template <typename Scalar>
+inline ScalarLanes<Scalar> subtract (ScalarLanes<Scalar> a, ScalarLanes<Scalar> b) noexcept { return eachLane(a, b, [] (Scalar x, Scalar y) { return x - y; }); }
+template <typename Scalar>
+inline ScalarLanes<Scalar> multiply (ScalarLanes<Scalar> a, ScalarLanes<Scalar> b) noexcept { return eachLane(a, b, [] (Scalar x, Scalar y) { return x * y; }); }
+
+#if JUCE_INTEL
+using LaneVector = __m128;
+
+inline LaneVector loadLanes (const float* data) noexcept              { return _mm_loadu_ps(data); }
+inline void storeLanes (float* data, LaneVector v) noexcept           { _mm_storeu_ps(data, v); }
+inline LaneVector broadcast (float value) noexcept                    { return _mm_set1_ps(value); }
+inline LaneVector add (LaneVector a, LaneVector b) noexcept           { return _mm_add_ps(a, b); }
+inline LaneVector subtract (LaneVector a, LaneVector b) noexcept      { return _mm_sub_ps(a, b); }
+inline LaneVector multiply (LaneVector a, LaneVector b) noexcept      { return _mm_mul_ps(a, b); }
+
+struct DoubleLaneVector { __m128d low, high; };
+
+inline DoubleLaneVector loadLanes (const double* data) noexcept                   { return { _mm_loadu_pd(data), _mm_loadu_pd(data + 2) }; }
+inline void storeLanes (double* data, DoubleLaneVector v) noexcept                { _mm_storeu_pd(data, v.low); _mm_storeu_pd(data + 2, v.high); }
+inline DoubleLaneVector broadcast (double value) noexcept                         { return { _mm_set1_pd(value), _mm_set1_pd(value) }; }
+inline DoubleLaneVector add (DoubleLaneVector a, DoubleLaneVector b) noexcept      { return { _mm_add_pd(a.low, b.low), _mm_add_pd(a.high, b.high) }; }
+inline DoubleLaneVector subtract (DoubleLaneVector a, DoubleLaneVector b) noexcept { return { _mm_sub_pd(a.low, b.low), _mm_sub_pd(a.high, b.high) }; }
+inline DoubleLaneVector multiply (DoubleLaneVector a, DoubleLaneVector b) noexcept { return { _mm_mul_pd(a.low, b.low), _mm_mul_pd(a.high, b.high) }; }
+#elif DISTORTION_USE_NEON
+using LaneVector = float32x4_t;
+
+inline LaneVector loadLanes (const float* data) noexcept              { return vld1q_f32(data); }
+inline void storeLanes (float* data, LaneVector v) noexcept           { vst1q_f32(data, v); }
+inline LaneVector broadcast (float value) noexcept                    { return vdupq_n_f32(value); }
+inline LaneVector add (LaneVector a, LaneVector b) noexcept           { return vaddq_f32(a, b); }
+inline LaneVector subtract (LaneVector a, LaneVector b) noexcept      { return vsubq_f32(a, b); }
+inline LaneVector multiply (LaneVector a, LaneVector b) noexcept      { return vmulq_f32(a, b); }
+
+ #if defined (__aarch64__)
+struct DoubleLaneVector { float64x2_t low, high; };
+
+inline DoubleLaneVector loadLanes (const double* data) noexcept                   { return { vld1q_f64(data), vld1q_f64(data + 2) }; }
+inline void storeLanes (double* data, DoubleLaneVector v) noexcept                { vst1q_f64(data, v.low); vst1q_f64(data + 2, v.high); }
+inline DoubleLaneVector broadcast (double value) noexcept                         { return { vdupq_n_f64(value), vdupq_n_f64(value) }; }
+inline DoubleLaneVector add (DoubleLaneVector a, DoubleLaneVector b) noexcept      { return { vaddq_f64(a.low, b.low), vaddq_f64(a.high, b.high) }; }
+inline DoubleLaneVector subtract (DoubleLaneVector a, DoubleLaneVector b) noexcept { return { vsubq_f64(a.low, b.low), vsubq_f64(a.high, b.high) }; }
+inline DoubleLaneVector multiply (DoubleLaneVector a, DoubleLaneVector b) noexcept { return { vmulq_f64(a.low, b.low), vmulq_f64(a.high, b.high) }; }
+ #else
+using DoubleLaneVector = ScalarLanes<double>;
+ #endif
+#else
+using LaneVector = ScalarLanes<float>;
+using DoubleLaneVector = ScalarLanes<double>;
+#endif
+
+// the vector type for each sample type.
+template <typename SampleType> struct Lanes;
+template <> struct Lanes<float>  { using Vector = LaneVector; };
+template <> struct Lanes<double> { using Vector = DoubleLaneVector; };
+
+// the tilt turns around this frequency.
+constexpr double tiltPivot = 700.0;
+
+// filter history below this level is inaudible, and flushing it keeps silence out of the denormal range.
+constexpr double denormalThreshold = 1.0e-15;
+}
+
+//==============================================================================
+void ToneFilterStage::prepare (double sampleRate, int numChannels)
+{
+    static_assert (laneCount == vectorLanes, "one channel per lane of a 4-wide vector");
+
+    _sampleRate = sampleRate;
+    _numChannels = juce::jmax(0, numChannels);
+    auto numGroups = (size_t) ((_numChannels + laneCount - 1) / laneCount);
+    _floatFilters.states.assign(numGroups, GroupState<float> {});
+    _doubleFilters.states.assign(numGroups, GroupState<double> {});
+
+    // force the coefficients to be rebuilt for the first block.
+    _coefficientRate = 0.0;
+}
+
+void ToneFilterStage::reset() noexcept
+{
+    std::fill(_floatFilters.states.begin(), _floatFilters.states.end(), GroupState<float> {});
+    std::fill(_doubleFilters.states.begin(), _doubleFilters.states.end(), GroupState<double> {});
+}
+
+template <>
+ToneFilterStage::Filters<float>& ToneFilterStage::getFilters<float>() noexcept
+{
+    return _floatFilters;
+}
+
+template <>
+ToneFilterStage::Filters<double>& ToneFilterStage::getFilters<double>() noexcept
+{
+    return _doubleFilters;
+}
+
+template <typename SampleType>
+void ToneFilterStage::clearSection (Filters<SampleType>& filters, int section) noexcept
+{
+    for (auto& state : filters.states)
+    {
+        std::fill(std::begin(state.z1[section]), std::end(state.z1[section]), SampleType (0));
+        std::fill(std::begin(state.z2[section]), std::end(state.z2[section]), SampleType (0));
+    }
+}
+
+void ToneFilterStage::setSettings (const Settings& settings) noexcept
+{
+    const float values[TotalSectionNum] = { settings.lowCut, settings.tilt, settings.highCut };
+    auto rateChanged = _coefficientRate != _sampleRate;
+
+    _numActiveSections = 0;
+    for (auto section = 0; section < TotalSectionNum; ++section)
+    {
+        // automation usually moves one control at a time, so the others keep their coefficients.
+        if (rateChanged || values[section] != _sectionValues[section])
+        {
+            _sectionValues[section] = values[section];
+            auto active = updateSection(section, values[section]);
+
+            // a section that was skipped kept its old history, so it starts from silence.
+            if (active && ! _sectionActive[section])
+            {
+                clearSection(_floatFilters, section);
+                clearSection(_doubleFilters, section);
+            }
+
+            _sectionActive[section] = active;
+        }
+
+        if (_sectionActive[section])
+            _activeSections[_numActiveSections++] = section;
+    }
+
+    _coefficientRate = _sampleRate;
+}
+
+bool ToneFilterStage::updateSection (int section, float value) noexcept
+{
+    // keep every corner well below Nyquist.
+    auto frequency = section == Tilt ? tiltPivot : (double) value;
+    auto w0 = juce::MathConstants<double>::twoPi * juce::jmin(frequency, _sampleRate * 0.45) / _sampleRate;
+    auto cosw0 = std::cos(w0);
+    auto sinw0 = std::sin(w0);
+
+    double b0, b1, b2, a0, a1, a2;
+
+    switch (section)
+    {
+    case LowCut:
+    case HighCut:
+    {
+        if (section == LowCut ? value <= lowCutOff : value >= highCutOff)
+            return false;
+
+        // 2nd-order Butterworth (12 dB/oct).
+        auto alpha = sinw0 / juce::MathConstants<double>::sqrt2;
+        auto sign = section == LowCut ? -1.0 : 1.0;
+        b1 = sign * (1.0 - sign * cosw0);
+        b0 = b2 = (1.0 - sign * cosw0) / 2.0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cosw0;
+        a2 = 1.0 - alpha;
+        break;
+    }
+    case Tilt:
+    {
+        if (value == 0.0f)
+            return false;
+
+        // a low shelf cutting by the full tilt, raised by half of it: -tilt/2 dB below the pivot, +tilt/2 dB above.
+        auto a = std::pow(10.0, -value / 40.0);
+        auto alpha = sinw0 / 2.0 * juce::MathConstants<double>::sqrt2;
+        auto twoSqrtAAlpha = 2.0 * std::sqrt(a) * alpha;
+
+        b0 = ((a + 1.0) - (a - 1.0) * cosw0 + twoSqrtAAlpha);
+        b1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosw0);
+        b2 = ((a + 1.0) - (a - 1.0) * cosw0 - twoSqrtAAlpha);
+        a0 = (a + 1.0) + (a - 1.0) * cosw0 + twoSqrtAAlpha;
+        a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cosw0);
+        a2 = (a + 1.0) + (a - 1.0) * cosw0 - twoSqrtAAlpha;
+        break;
+    }
+    default:
+        return false;
+    }
+
+    auto& coefficients = _doubleFilters.coefficients[section];
+    coefficients.b0 = b0 / a0;
+    coefficients.b1 = b1 / a0;
+    coefficients.b2 = b2 / a0;
+    coefficients.a1 = a1 / a0;
+    coefficients.a2 = a2 / a0;
+
+    auto& rounded = _floatFilters.coefficients[section];
+    rounded.b0 = (float) coefficients.b0;
+    rounded.b1 = (float) coefficients.b1;
+    rounded.b2 = (float) coefficients.b2;
+    rounded.a1 = (float) coefficients.a1;
+    rounded.a2 = (float) coefficients.a2;
+    return true;
+}
+
+template <typename SampleType>
+void ToneFilterStage::process (juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numChannels) noexcept
+{
+    if (_numActiveSections == 0)
+        return;
+
+    using Vector = typename Lanes<SampleType>::Vector;
+    auto& filters = getFilters<SampleType>();
+
+    numChannels = juce::jmin(numChannels, _numChannels, buffer.getNumChannels());
+
+    for (auto group = 0; group * laneCount < numChannels; ++group)
+    {
+        auto firstChannel = group * laneCount;
+        auto groupChannels = juce::jmin(laneCount, numChannels - firstChannel);
+
+        SampleType* channels[laneCount] = {};
+        for (auto lane = 0; lane < groupChannels; ++lane)
+            channels[lane] = buffer.getWritePointer(firstChannel + lane, startSample);
+
+        auto& state = filters.states[(size_t) group];
+
+        Vector b0[TotalSectionNum], b1[TotalSectionNum], b2[TotalSectionNum], a1[TotalSectionNum], a2[TotalSectionNum];
+        Vector z1[TotalSectionNum], z2[TotalSectionNum];
+        for (auto stage = 0; stage < _numActiveSections; ++stage)
+        {
+            auto section = _activeSections[stage];
+            const auto& coefficients = filters.coefficients[section];
+            b0[stage] = broadcast(coefficients.b0);
+            b1[stage] = broadcast(coefficients.b1);
+            b2[stage] = broadcast(coefficients.b2);
+            a1[stage] = broadcast(coefficients.a1);
+            a2[stage] = broadcast(coefficients.a2);
+            z1[stage] = loadLanes(state.z1[section]);
+            z2[stage] = loadLanes(state.z2[section]);
+        }
+
+        // unused lanes stay at zero, so they never feed anything back.
+        SampleType input[laneCount] = {};
+        SampleType output[laneCount];
+
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            for (auto lane = 0; lane < groupChannels; ++lane)
+                input[lane] = channels[lane][i];
+
+            auto x = loadLanes(input);
+
+            // transposed direct form II.
+            for (auto stage = 0; stage < _numActiveSections; ++stage)
+            {
+                auto y = add(multiply(b0[stage], x), z1[stage]);
+                z1[stage] = add(subtract(multiply(b1[stage], x), multiply(a1[stage], y)), z2[stage]);
+                z2[stage] = subtract(multiply(b2[stage], x), multiply(a2[stage], y));
+                x = y;
+            }
+
+            storeLanes(output, x);
+            for (auto lane = 0; lane < groupChannels; ++lane)
+                channels[lane][i] = output[lane];
+        }
+
+        // a decaying tail would otherwise linger in denormals through every silent block after it.
+        for (auto stage = 0; stage < _numActiveSections; ++stage)
+        {
+            auto section = _activeSections[stage];
+            storeLanes(state.z1[section], z1[stage]);
+            storeLanes(state.z2[section], z2[stage]);
+
+            for (auto lane = 0; lane < laneCount; ++lane)
+            {
+                if (std::abs(state.z1[section][lane]) < (SampleType) denormalThreshold)
+                    state.z1[section][lane] = 0;
+                if (std::abs(state.z2[section][lane]) < (SampleType) denormalThreshold)
+                    state.z2[section][lane] = 0;
+            }
+        }
+    }
+}
+
+template void ToneFilterStage::process<float> (juce::AudioBuffer<float>&, int, int, int) noexcept;
+template void ToneFilterStage::process<double> (juce::AudioBuffer<double>&, int, int, int) noexcept;
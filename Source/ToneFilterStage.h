@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    ToneFilterStage.h
+    Tilt / low-cut / high-cut biquad cascade, several channels per SIMD vector.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class ToneFilterStage
+{
+public:
+    // `g͈̔(dB) (ōグA)
+    static constexpr float maximumTilt = 12.0f;
+
+    // [JbgEnCJbg͈̔(Hz) ([Jbg̉ƃnCJbg̏OFF)
+    static constexpr float lowCutOff = 20.0f;
+    static constexpr float lowCutMaximum = 2000.0f;
+    static constexpr float highCutMinimum = 1000.0f;
+    static constexpr float highCutOff = 20000.0f;
+
+    // tB^ݒ
+    struct Settings
+    {
+        float tilt = 0.0f;              // `g(dB)
+        float lowCut = lowCutOff;       // [Jbgg(Hz)
+        float highCut = highCutOff;     // nCJbgg(Hz)
+    };
+
+    // ĐȌ
+    void prepare(double sampleRate, int numChannels);
+
+    // tB^̏Ԃ̃NA
+    void reset() noexcept;
+
+    // tB^ݒ (lTv[gωî݌WČvZ)
+    void setSettings(const Settings& settings) noexcept;
+
+    // SĂ̒iOFF (OFF̏ꍇ process ͉Ȃ)
+    bool isBypassed() const noexcept { return _numActiveSections == 0; }
+
+    // tB^ (`lSIMD̃[Ɋ蓖ĂēɌvZAdouble ͌WEԂ double)
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numChannels) noexcept;
+
+private:
+    // i ([JbgA`gAnCJbg̏)
+    enum Section
+    {
+        LowCut = 0,
+        Tilt,
+        HighCut,
+        TotalSectionNum,
+    };
+
+    // 1xNg̃[ (= ɏ`l)
+    static constexpr int laneCount = 4;
+
+    // o2tB^1ǐW
+    template <typename SampleType>
+    struct Coefficients
+    {
+        SampleType b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    };
+
+    // 1[1`l̃tB^ (laneCount `l)
+    template <typename SampleType>
+    struct GroupState
+    {
+        SampleType z1[TotalSectionNum][laneCount];
+        SampleType z2[TotalSectionNum][laneCount];
+    };
+
+    // xƂ̌WƏ (float  double ̏ŕʂɎ)
+    template <typename SampleType>
+    struct Filters
+    {
+        Coefficients<SampleType> coefficients[TotalSectionNum];
+        std::vector<GroupState<SampleType>> states;
+    };
+
+    // ̐xɑΉWƏ
+    template <typename SampleType>
+    Filters<SampleType>& getFilters() noexcept;
+
+    // ȉԂ̃NA
+    template <typename SampleType>
+    static void clearSection(Filters<SampleType>& filters, int section) noexcept;
+
+    // ǐW̌vZ (OFF̒lȂ false)
+    bool updateSection(int section, float value) noexcept;
+
+    double _sampleRate = 44100.0;
+    int _numChannels = 0;
+
+    Filters<float> _floatFilters;
+    Filters<double> _doubleFilters;
+    float _sectionValues[TotalSectionNum] = {};     // WvZl
+    double _coefficientRate = 0.0;                  // WvZTv[g (0 ͖vZ)
+    bool _sectionActive[TotalSectionNum] = {};
+    int _activeSections[TotalSectionNum] = {};      // i (ȉ)
+    int _numActiveSections = 0;
+};
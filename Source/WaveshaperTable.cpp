@@ -0,0 +1,203 @@
+/*
+  ==============================================================================
+
+    WaveshaperTable.cpp
+    Precomputed tanh transfer curve with interpolated lookups.
+
+  ==============================================================================
+*/
+
+#include "WaveshaperTable.h"
+#include "DistortionKernels.h"
+
+namespace
+{
+// log(cosh(x)), the antiderivative of tanh(x).
+double logCosh (double x) noexcept
+{
+    auto a = std::abs(x);
+    return a + std::log1p(std::exp(-2.0 * a)) - juce::MathConstants<double>::ln2;
+}
+}
+
+//==============================================================================
+class WaveshaperTable::Builder  : public juce::Thread
+{
+public:
+    explicit Builder (WaveshaperTable& owner)
+        : juce::Thread ("Waveshaper table builder"), _owner (owner)
+    {
+    }
+
+    void run() override
+    {
+        // poll instead of being notified, so that requestDrive never takes a lock.
+        while (! threadShouldExit())
+        {
+            _owner.build(_owner._requestedDrive.load());
+            wait(pollIntervalMilliseconds);
+        }
+    }
+
+private:
+    static constexpr int pollIntervalMilliseconds = 10;
+
+    WaveshaperTable& _owner;
+};
+
+//==============================================================================
+WaveshaperTable::WaveshaperTable()
+{
+}
+
+WaveshaperTable::~WaveshaperTable()
+{
+    release();
+}
+
+void WaveshaperTable::setOptions (int tableSize, Interpolation interpolation) noexcept
+{
+    _tableSize = juce::jlimit(16, 1 << 20, tableSize);
+    _interpolation = interpolation;
+}
+
+void WaveshaperTable::prepare (float initialDrive)
+{
+    // the builder writes into the slots, so it must not run while they are reallocated.
+    release();
+
+    _preparedTableSize = _tableSize;
+    _preparedInterpolation = _interpolation;
+    _publishedSlot = -1;
+    _readingSlot = -1;
+
+    if (_preparedInterpolation == Direct)
+    {
+        for (auto& slot : _slots)
+            slot.values.free();
+        return;
+    }
+
+    // one guard value before and two after the table, for the cubic neighbours.
+    for (auto& slot : _slots)
+    {
+        slot.values.allocate((size_t) _preparedTableSize + 3, true);
+        slot.drive = 0.0f;
+    }
+
+    if (_builder == nullptr)
+        _builder = std::make_unique<Builder>(*this);
+
+    _requestedDrive = initialDrive;
+    _builder->startThread();
+}
+
+void WaveshaperTable::release()
+{
+    if (_builder != nullptr)
+        _builder->stopThread(1000);
+}
+
+void WaveshaperTable::requestDrive (float drive) noexcept
+{
+    _requestedDrive.store(drive);
+}
+
+void WaveshaperTable::build (float drive) noexcept
+{
+    // tanh(0 * x) is silence, which the direct path already handles.
+    if (drive <= 0.0f)
+        return;
+
+    auto published = _publishedSlot.load();
+    if (published >= 0 && _slots[published].drive == drive)
+        return;
+
+    // pick a slot that is neither published nor still being read by the audio thread.
+    auto reading = _readingSlot.load();
+    auto target = 0;
+    while (target == published || target == reading)
+        ++target;
+
+    auto& slot = _slots[target];
+    auto inputRange = DistortionKernels::tanhClampRange / (double) drive;
+    auto step = 2.0 * inputRange / (double) (_preparedTableSize - 1);
+
+    // each entry is the mean of the curve over its own cell, so the table is band-limited to its resolution.
+    for (auto i = -1; i <= _preparedTableSize + 1; ++i)
+    {
+        auto x = -inputRange + step * i;
+        auto upper = logCosh((double) drive * (x + 0.5 * step));
+        auto lower = logCosh((double) drive * (x - 0.5 * step));
+        slot.values[i + 1] = (float) ((upper - lower) / ((double) drive * step));
+    }
+
+    slot.drive = drive;
+    slot.inputRange = (float) inputRange;
+    slot.scale = (float) (1.0 / step);
+
+    _publishedSlot.store(target);
+}
+
+bool WaveshaperTable::process (float* data, int numSamples, float inputGain, float drive) noexcept
+{
+    if (_preparedInterpolation == Direct)
+        return false;
+
+    // claim the published slot; retry if the builder published another one in between.
+    int current;
+    do
+    {
+        current = _publishedSlot.load();
+        _readingSlot.store(current);
+    }
+    while (_publishedSlot.load() != current);
+
+    if (current < 0 || _slots[current].drive != drive)
+        return false;
+
+    const auto& slot = _slots[current];
+    const auto* table = slot.values.get() + 1;
+    const auto scale = slot.scale * inputGain;
+    const auto offset = slot.inputRange * slot.scale;
+    const auto maxPosition = (float) (_preparedTableSize - 1);
+
+    if (_preparedInterpolation == Linear)
+    {
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            auto position = juce::jlimit(0.0f, maxPosition, data[i] * scale + offset);
+            auto index = (int) position;
+            auto fraction = position - (float) index;
+
+            data[i] = table[index] + fraction * (table[index + 1] - table[index]);
+        }
+    }
+    else
+    {
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            auto position = juce::jlimit(0.0f, maxPosition, data[i] * scale + offset);
+            auto index = (int) position;
+            auto t = position - (float) index;
+
+            // catmull-rom through table[index - 1] ~ table[index + 2].
+            auto p0 = table[index - 1];
+            auto p1 = table[index];
+            auto p2 = table[index + 1];
+            auto p3 = table[index + 2];
+
+            data[i] = p1 + 0.5f * t * ((p2 - p0) + t * ((2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) + t * (3.0f * (p1 - p2) + p3 - p0)));
+        }
+    }
+
+    return true;
+}
+
+size_t WaveshaperTable::getMemoryFootprint() const noexcept
+{
+    if (_preparedInterpolation == Direct)
+        return 0;
+
+    return (size_t) numSlots * ((size_t) _preparedTableSize + 3) * sizeof(float);
+}
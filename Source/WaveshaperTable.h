@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    WaveshaperTable.h
+    Precomputed tanh transfer curve with interpolated lookups.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class WaveshaperTable
+{
+public:
+    // ԕ@
+    enum Interpolation
+    {
+        Direct = 0,  // e[ug킸ڌvZ
+        Linear,      // `
+        Cubic,       // 3 (Catmull-Rom)
+        TotalInterpolationNum,
+    };
+
+    WaveshaperTable();
+    ~WaveshaperTable();
+
+    // e[uƕԕ@̐ݒ ( prepare L)
+    void setOptions(int tableSize, Interpolation interpolation) noexcept;
+
+    // ĐȌ (e[upobt@̊mۂƐXbh̊Jn)
+    void prepare(float initialDrive);
+
+    // Xbh̒~
+    void release();
+
+    // e[u̗v (͕ʃXbhōsAbNȂ)
+    void requestDrive(float drive) noexcept;
+
+    // data = tanh(data * inputGain * drive) e[uQƂŌvZ
+    // drive Ɉve[u܂ꍇ͉ false Ԃ
+    bool process(float* data, int numSamples, float inputGain, float drive) noexcept;
+
+    // mۍς݃e[u̍vTCY(oCg)
+    size_t getMemoryFootprint() const noexcept;
+
+private:
+    // ς݃e[u1
+    struct Slot
+    {
+        juce::HeapBlock<float> values;  // Oɕԗp̃K[hl܂
+        float drive = 0.0f;             //  drive (0 ͖)
+        float inputRange = 1.0f;        // e[u͔͈ [-inputRange, inputRange]
+        float scale = 1.0f;             // ͒l -> e[uʒu
+    };
+
+    // EJEQƒ̃XbgdȂȂ悤 3 ŉ
+    static constexpr int numSlots = 3;
+
+    class Builder;
+
+    void build(float drive) noexcept;
+
+    Slot _slots[numSlots];
+    std::atomic<int> _publishedSlot { -1 };
+    std::atomic<int> _readingSlot { -1 };
+    std::atomic<float> _requestedDrive { 0.0f };
+
+    int _tableSize = 4096;
+    Interpolation _interpolation = Direct;
+    int _preparedTableSize = 0;
+    Interpolation _preparedInterpolation = Direct;
+
+    std::unique_ptr<Builder> _builder;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveshaperTable)
+};